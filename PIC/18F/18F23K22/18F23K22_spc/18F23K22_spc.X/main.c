@@ -20,24 +20,24 @@
  *  First posted here: http://www.microchip.com/forums/FindPost/853615
  *
  *
- *                PIC18F23K22
- *         +---------:_:---------+
- *  RE3 -> :  1 VPP       PGD 28 : <> RB7
- *  RA0 <> :  2           PGC 27 : <> RB6
- *  RA1 <> :  3               26 : <> RB5
- *  RA2 <> :  4               25 : <> RB4
- *  RA3 <> :  5               24 : <> RB3
- *  RA4 <> :  6               23 : <> RB2
- *  RA5 <> :  7               22 : <> RB1
- *  VSS -> :  8          INT0 21 : <> RB0
- *  RA7 <> :  9 OSC1          20 : <- VDD
- *  RA6 <> : 10 OSC2          19 : <- VSS
- *  RC0 <> : 11 SOSCO         18 : <> RC7
- *  RC1 <> : 12 SOSCI         17 : <> RC6
- *  RC2 <> : 13               16 : <> RC5
- *  RC3 <> : 14               15 : <> RC4
- *         +---------------------+
- *                 DIP-28
+ *                           PIC18F23K22
+ *                    +---------:_:---------+
+ *             RE3 -> :  1 VPP       PGD 28 : <> RB7
+ *  MUX_SEL0   RA0 <> :  2           PGC 27 : <> RB6
+ *  MUX_SEL1   RA1 <> :  3               26 : <> RB5 CCP3
+ *  MUX_SEL2   RA2 <> :  4               25 : <> RB4 TRIG_ADR3
+ *  MUX_SEL3   RA3 <> :  5               24 : <> RB3 TRIG_ADR2
+ *  CCP5       RA4 <> :  6               23 : <> RB2 TRIG_ADR1
+ *             RA5 <> :  7               22 : <> RB1 TRIG_ADR0
+ *             VSS -> :  8          INT0 21 : <> RB0 CCP4
+ *             RA7 <> :  9 OSC1          20 : <- VDD
+ *             RA6 <> : 10 OSC2          19 : <- VSS
+ *  T3G        RC0 <> : 11 SOSCO         18 : <> RC7 RXD1
+ *  CCP2       RC1 <> : 12 SOSCI         17 : <> RC6 TXD1
+ *  CCP1       RC2 <> : 13               16 : <> RC5
+ *  TRIG       RC3 <> : 14               15 : <> RC4 ISR_STATS_PIN
+ *                    +---------------------+
+ *                           DIP-28
  * 
  */  
     
@@ -45,7 +45,7 @@
     
 #pragma config FOSC = INTIO67, PLLCFG = OFF, PRICLKEN = ON, FCMEN = OFF
 #pragma config IESO = OFF, PWRTEN = ON, BOREN = OFF, BORV = 220, WDTEN = OFF
-#pragma config WDTPS = 32768, CCP2MX = PORTC1, PBADEN = OFF, CCP3MX = PORTC6
+#pragma config WDTPS = 32768, CCP2MX = PORTC1, PBADEN = OFF, CCP3MX = PORTB5
 #pragma config HFOFST = OFF, T3CMX = PORTC0, P2BMX = PORTC0, MCLRE = EXTMCLR
 #pragma config STVREN = ON, LVP = OFF, XINST = OFF
 #pragma config CP0 = OFF, CP1 = OFF, CPB = OFF, CPD = OFF
@@ -58,35 +58,710 @@
  * Application constants
  */
 #define SENSOR_SAMPLE_SIZE 16
+#define SENSOR_NO_ECHO      0xFFFF  /* result of a sensor without a pulse */
+/*
+ * Set to 1 to capture round after round without stopping. Each
+ * completed round is published as a frame while the next one
+ * fills the other frame buffer. Set to 0 to capture one round
+ * for each call to StartSensorCapture.
+ */
+#define SENSOR_FREE_RUN 1
+/*
+ * Set to 1 to measure SENSOR_GROUP_SIZE sensors at once. CCP1
+ * to CCP5 capture both edges of the pulses against TIMER3,
+ * which runs free, and the width is the difference. Set to 0 to
+ * measure one sensor at a time with the TIMER3 gate on RC0.
+ *
+ * In CCP mode the multiplexer and trigger addresses pick a group
+ * of five sensors, the multiplexer has five sections and sensor n
+ * of the group goes to CCPn+1. The width wraps on a pulse longer
+ * than 65536 TIMER3 counts, about 16ms at 1:1, but the echo
+ * timeout is longer. TIMER5 is read at both edges as well and a
+ * pulse it shows to be longer than the TIMER3 width reads as
+ * SENSOR_MAX_VALUE.
+ */
+#ifndef SENSOR_CAPTURE_CCP
+#define SENSOR_CAPTURE_CCP 0
+#endif
+
+#if SENSOR_CAPTURE_CCP
+#define SENSOR_GROUP_SIZE 5
+#else
+#define SENSOR_GROUP_SIZE 1
+#endif
+#define SENSOR_GROUPS ((SENSOR_SAMPLE_SIZE+SENSOR_GROUP_SIZE-1)/SENSOR_GROUP_SIZE)
+
+#define CCP_CAPTURE_FALL 0x04
+#define CCP_CAPTURE_RISE 0x05
+/*
+ * Distance conversion
+ *
+ * Set SENSOR_UNITS_MM to 1 for 16-bit millimetre results. The
+ * TIMER3 prescaler is the smallest one that can count a pulse
+ * for SENSOR_RANGE_MM, so the resolution is the best the range
+ * allows. A pulse of SENSOR_NS_PER_MM is one millimetre, 5800ns
+ * for an ultrasonic echo at 343m/s there and back. Results are
+ * clamped to SENSOR_RANGE_MM. The conversion is a multiply by
+ * millimetres per count scaled by 2^16, SENSOR_MM_SCALE, worked
+ * out from FOSC at compile time.
+ *
+ * Set SENSOR_UNITS_MM to 0 for the 8-bit scale below with TIMER3
+ * at 1:1. SENSOR_UNITS_MM and SENSOR_TICKS_PER_UNIT can also be
+ * set on the compiler command line, the host tests in ../test
+ * build them several ways.
+ */
+#ifndef SENSOR_UNITS_MM
+#define SENSOR_UNITS_MM     0
+#endif
+#define SENSOR_RANGE_MM     4000L
+#define SENSOR_NS_PER_MM    5800L
+
+#if SENSOR_UNITS_MM
+#define SENSOR_RANGE_CYCLES (SENSOR_RANGE_MM*SENSOR_NS_PER_MM/1000L*(FCYC/1000000L))
+#if SENSOR_RANGE_CYCLES <= 65535L
+#define SENSOR_T3CKPS       0
+#elif SENSOR_RANGE_CYCLES <= 2*65535L
+#define SENSOR_T3CKPS       1
+#elif SENSOR_RANGE_CYCLES <= 4*65535L
+#define SENSOR_T3CKPS       2
+#elif SENSOR_RANGE_CYCLES <= 8*65535L
+#define SENSOR_T3CKPS       3
+#else
+#error SENSOR_RANGE_MM too long for TIMER3 at 1:8 prescale
+#endif
+#define SENSOR_RANGE_TICKS  (SENSOR_RANGE_CYCLES >> SENSOR_T3CKPS)
+#define SENSOR_MM_SCALE     (((1000L<<SENSOR_T3CKPS)*65536L+(FCYC/1000000L)*SENSOR_NS_PER_MM/2)/((FCYC/1000000L)*SENSOR_NS_PER_MM))
+#define SENSOR_MAX_VALUE    SENSOR_RANGE_MM
+
+#if SENSOR_RANGE_MM >= SENSOR_NO_ECHO
+#error SENSOR_RANGE_MM must be less than SENSOR_NO_ECHO
+#endif
+#if SENSOR_MM_SCALE > 65535L
+#error TIMER3 count is more than 1mm, raise FOSC
+#endif
+#else
+#define SENSOR_T3CKPS       0
+#define SENSOR_MAX_VALUE    SENSOR_MAX_UNITS
+#endif
+/*
+ * 8-bit distance scale
+ *
+ * A pulse of SENSOR_TICKS_PER_UNIT TIMER3 counts is one unit of
+ * distance, 58 for centimetres from an ultrasonic echo time in
+ * microseconds. Results are clamped to SENSOR_MAX_UNITS.
+ *
+ * The divide is done as a multiply by the reciprocal scaled by
+ * 2^SENSOR_RECIP_SHIFT. The reciprocal has 17 bits and the top
+ * one is always set, SENSOR_RECIP holds the low 16 and the count
+ * is added back after MulHigh. With 17 bits the result is exact
+ * for every count below the clamp and every SENSOR_TICKS_PER_UNIT
+ * from 2 to 257, ../test checks all of them. It is exact when
+ * every count below the clamp times the rounding error of the
+ * reciprocal stays under 2^SENSOR_RECIP_SHIFT, the build stops
+ * when it does not.
+ */
+#ifndef SENSOR_TICKS_PER_UNIT
+#define SENSOR_TICKS_PER_UNIT 58
+#endif
+#define SENSOR_MAX_UNITS 255
+#define SENSOR_MAX_TICKS (1UL*SENSOR_MAX_UNITS*SENSOR_TICKS_PER_UNIT)
+
+#if SENSOR_TICKS_PER_UNIT > 256
+#define SENSOR_RECIP_SHIFT 25
+#elif SENSOR_TICKS_PER_UNIT > 128
+#define SENSOR_RECIP_SHIFT 24
+#elif SENSOR_TICKS_PER_UNIT > 64
+#define SENSOR_RECIP_SHIFT 23
+#elif SENSOR_TICKS_PER_UNIT > 32
+#define SENSOR_RECIP_SHIFT 22
+#elif SENSOR_TICKS_PER_UNIT > 16
+#define SENSOR_RECIP_SHIFT 21
+#elif SENSOR_TICKS_PER_UNIT > 8
+#define SENSOR_RECIP_SHIFT 20
+#elif SENSOR_TICKS_PER_UNIT > 4
+#define SENSOR_RECIP_SHIFT 19
+#elif SENSOR_TICKS_PER_UNIT > 2
+#define SENSOR_RECIP_SHIFT 18
+#else
+#define SENSOR_RECIP_SHIFT 17
+#endif
+#define SENSOR_RECIP_17 (((1UL<<SENSOR_RECIP_SHIFT)+SENSOR_TICKS_PER_UNIT-1)/SENSOR_TICKS_PER_UNIT)
+#define SENSOR_RECIP (SENSOR_RECIP_17-65536UL)
+
+#if !SENSOR_UNITS_MM
+#if SENSOR_MAX_UNITS > 255
+#error SENSOR_MAX_UNITS must fit in 8 bits
+#endif
+#if SENSOR_TICKS_PER_UNIT < 2
+#error SENSOR_TICKS_PER_UNIT must be 2 or more
+#endif
+#if SENSOR_MAX_TICKS > 65535
+#error SENSOR_MAX_UNITS times SENSOR_TICKS_PER_UNIT must fit in TIMER3
+#endif
+#if (SENSOR_MAX_TICKS-1)*(SENSOR_RECIP_17*SENSOR_TICKS_PER_UNIT-(1UL<<SENSOR_RECIP_SHIFT)) >= (1UL<<SENSOR_RECIP_SHIFT)
+#error SENSOR_TICKS_PER_UNIT reciprocal is not exact up to SENSOR_MAX_UNITS
+#endif
+#endif
+/*
+ * Sensor multiplexer
+ *
+ * The echo of the selected sensor goes to the TIMER3 gate on RC0
+ * through an analog multiplexer (74HC4067) addressed by the
+ * MUX_SEL bits. Each sensor has its own trigger from a 1 of 16
+ * decoder (74HC154 with an inverter) addressed by the TRIG_ADR
+ * bits and enabled by the TRIG pin for TRIG_PULSE_US.
+ *
+ * The two address buses are separate so the trigger address of
+ * the next sensor can be set up while the current pulse is still
+ * being measured. When the pulse ends the ISR only has to switch
+ * the multiplexer, re-arm the gate and raise TRIG. The multiplexer
+ * settles during the delay from trigger to echo.
+ */
+#define MUX_SEL_LAT     LATA
+#define MUX_SEL_TRIS    TRISA
+#define MUX_SEL_SHIFT   0
+#define MUX_SEL_MASK    (0x0F<<MUX_SEL_SHIFT)
+#define TRIG_ADR_LAT    LATB
+#define TRIG_ADR_TRIS   TRISB
+#define TRIG_ADR_SHIFT  1
+#define TRIG_ADR_MASK   (0x0F<<TRIG_ADR_SHIFT)
+#define TRIG            LATCbits.LATC3
+#define TRIG_TRIS       TRISCbits.TRISC3
+#define TRIG_PULSE_US   10
+#define TRIG_PULSE_CYCLES (TRIG_PULSE_US*(FCYC/1000000L))
+
+#if SENSOR_GROUPS > 16
+#error Multiplexer has 16 inputs
+#endif
+#if (TRIG_PULSE_CYCLES < 2) || (TRIG_PULSE_CYCLES > 256)
+#error TRIG_PULSE_US does not fit TIMER2 without a prescaler
+#endif
+/*
+ * Missing echo timeout
+ *
+ * TIMER5 runs at FCYC/8 from each trigger. When no pulse has
+ * ended SENSOR_TIMEOUT_US later the sensor gets SENSOR_NO_ECHO,
+ * its count in sensorTimeouts goes up and the next sensor is
+ * started. A dead sensor costs one timeout, not the whole round.
+ * The timeout is the longest wait for the echo to start plus the
+ * longest pulse to be measured.
+ */
+#define SENSOR_TIMEOUT_US   30000L
+#define SENSOR_TIMEOUT_COUNTS (SENSOR_TIMEOUT_US*(FCYC/1000000L)/8)
+
+#if (SENSOR_TIMEOUT_COUNTS < 1) || (SENSOR_TIMEOUT_COUNTS > 65535)
+#error SENSOR_TIMEOUT_US does not fit TIMER5 at 1:8 prescale
+#endif
+/*
+ * Round timing
+ *
+ * TIMER1 runs free at FCYC/8, 2us per count, the ISR extends it
+ * to 32 bits on overflow. Each frame holds the time its round
+ * took in these counts.
+ */
+#define ROUND_TIME_US   2
+/*
+ * High priority ISR instrumentation
+ *
+ * Set ISR_STATS to 1 to time InterruptHandlerHigh. TIMER0 runs
+ * free at FCYC, one count per instruction cycle, and is read
+ * on entry and exit. isrStats keeps the count, min, max and sum
+ * of the times in between, see GetIsrStats.
+ *
+ * The entry latency is taken for the end of the trigger pulse,
+ * the one interrupt with a known due time. It is how many cycles
+ * after the TIMER2 match the ISR started, context save included,
+ * to within a few cycles.
+ *
+ * ISR_STATS_PIN is high from entry to exit for a logic analyser.
+ * The stats update runs after the exit time is taken so it is
+ * not in the times, it does delay the next interrupt.
+ *
+ * With ISR_STATS at 0 none of it is built. It can be set on the
+ * command line too, ../test checks the stats against the model.
+ */
+#ifndef ISR_STATS
+#define ISR_STATS       0
+#endif
+#define ISR_STATS_PIN   LATCbits.LATC4
+#define ISR_STATS_TRIS  TRISCbits.TRISC4
+
+/* TIMER0 in 16-bit mode, TMR0H is latched when TMR0L is read */
+#define ISR_STATS_READ(t) { (t) = TMR0L; (t) |= (unsigned int)TMR0H << 8; }
+/*
+ * Filtering of each new frame in main
+ *
+ * SENSOR_MEDIAN is the number of rounds in the running median of
+ * each sensor, 3 or 5, 0 to turn it off. One odd reading, or a
+ * missing echo, is thrown away.
+ *
+ * The median then goes through an IIR low pass filter that moves
+ * 1/2^SENSOR_IIR_SHIFT of the way to each new value, 0 to turn it
+ * off. The filter keeps SENSOR_IIR_SHIFT fraction bits.
+ *
+ * SENSOR_NO_ECHO comes out when the median is SENSOR_NO_ECHO, the
+ * IIR filter is not changed by it.
+ *
+ * Both can be set on the command line too, ../test checks each
+ * way against a plain model of the filters.
+ */
+#ifndef SENSOR_MEDIAN
+#define SENSOR_MEDIAN       3
+#endif
+#ifndef SENSOR_IIR_SHIFT
+#define SENSOR_IIR_SHIFT    2
+#endif
+
+#if (SENSOR_MEDIAN != 0) && (SENSOR_MEDIAN != 3) && (SENSOR_MEDIAN != 5)
+#error SENSOR_MEDIAN must be 0, 3 or 5
+#endif
+#if ((SENSOR_MAX_VALUE+1L) << SENSOR_IIR_SHIFT) > 65536L
+#error SENSOR_IIR_SHIFT too big for the IIR filter state
+#endif
+/*
+ * Binary frame stream on EUSART1 TXD1 (RC6)
+ *
+ * Each new frame is sent as one packet, 8 data bits, no parity:
+ *
+ *   0xA5 0x5A      sync word
+ *   seq            round number, high byte first
+ *   16 values     distance of each sensor, one byte, 0xFE when
+ *                  at or past the range, 0xFF for no echo. With
+ *                  SENSOR_UNITS_MM two bytes, high byte first, in
+ *                  millimetres, 0xFFFF for no echo.
+ *   crc            CRC-8 (polynomial 0x07, start 0x00) of the
+ *                  round number and distances
+ *
+ * main loads the bytes into TXREG1 as soon as TX1IF shows room.
+ * At 1Mbaud there are 40 instruction cycles per byte, too few
+ * for an interrupt per byte. The capture interrupts can still
+ * break in, they only delay the next byte. When more than one
+ * round ends while main is busy only the newest is sent, seq
+ * shows the gap.
+ */
+#define STREAM_ENABLE       1
+#define STREAM_BAUD         1000000L
+#define STREAM_SYNC         0xA55A
+#if SENSOR_UNITS_MM
+#define STREAM_PACKET_SIZE  (2+2+2*SENSOR_SAMPLE_SIZE+1)
+#else
+#define STREAM_PACKET_SIZE  (2+2+SENSOR_SAMPLE_SIZE+1)
+#endif
+
+/* BRG16 = 1 and BRGH = 1, one BRG count is 4 FOSC clocks */
+#define STREAM_BRG          ((FOSC+2*STREAM_BAUD)/(4*STREAM_BAUD)-1)
+#define STREAM_REAL_BAUD    (FOSC/(4*(STREAM_BRG+1)))
+
+#if STREAM_ENABLE
+#if (STREAM_BRG < 0) || (STREAM_BRG > 65535)
+#error STREAM_BAUD out of range for EUSART1
+#endif
+#if (STREAM_REAL_BAUD-STREAM_BAUD)*50 > STREAM_BAUD || (STREAM_BAUD-STREAM_REAL_BAUD)*50 > STREAM_BAUD
+#error STREAM_BAUD error more than 2 percent from FOSC
+#endif
+#endif
 /*
  * global data
  */
-volatile int polledSensor = 0;
-volatile unsigned int sensorData[SENSOR_SAMPLE_SIZE];
+typedef struct {
+    unsigned int seq;                           /* round number, 0 until the first round */
+    unsigned long roundTime;                    /* round length in ROUND_TIME_US counts */
+    unsigned int sensorData[SENSOR_SAMPLE_SIZE];
+} SensorFrame_t;
+
+volatile int polledSensor = 0;                  /* first sensor of the group being measured */
+volatile int polledGroup = 0;                   /* multiplexer address of the group */
+volatile unsigned char captureOn = 0;           /* capture is running */
+volatile SensorFrame_t sensorFrame[2];
+volatile unsigned char sensorPublished = 0;    /* rounds done, low bit is the newest frame */
+unsigned int sensorSeq = 0;                     /* round number of the last frame, ISR only */
+unsigned int timer1High = 0;                    /* TIMER1 overflows, ISR only */
+unsigned long roundStart = 0;                   /* time the round started, ISR only */
+volatile unsigned char trigAdrNext = 0;         /* TRIG_ADR bits for the sensor after this one */
+volatile unsigned int sensorTimeouts[SENSOR_SAMPLE_SIZE]; /* missing echoes for each sensor */
+volatile unsigned long roundTimeMin = 0xFFFFFFFF; /* shortest round in ROUND_TIME_US counts, main only */
+volatile unsigned long roundTimeMax = 0;        /* longest round */
+#if STREAM_ENABLE
+unsigned char streamPacket[STREAM_PACKET_SIZE];
+#endif
+#if ISR_STATS
+typedef struct {
+    unsigned long count;                        /* ISR runs */
+    unsigned int timeMin;                       /* FCYC cycles from entry to exit */
+    unsigned int timeMax;
+    unsigned long timeSum;
+    unsigned long latencyCount;                 /* trigger pulse ends */
+    unsigned int latencyMin;                    /* FCYC cycles from the TIMER2 match to entry */
+    unsigned int latencyMax;
+    unsigned long latencySum;
+} IsrStats_t;
+
+IsrStats_t isrStats;                            /* ISR only, read with GetIsrStats */
+unsigned int isrTrigDue;                        /* TIMER0 at the end of the trigger pulse */
+volatile unsigned int isrTimeMean = 0;          /* FCYC cycles, worked out in main */
+volatile unsigned int isrLatencyMean = 0;
+#endif
+#if SENSOR_CAPTURE_CCP
+unsigned char ccpPending;                       /* CCP channels still waiting, ISR only */
+unsigned int ccpStart[SENSOR_GROUP_SIZE];       /* TIMER3 at the rising edges, ISR only */
+unsigned int ccpStart5[SENSOR_GROUP_SIZE];      /* TIMER5 at the rising edges, ISR only */
+#endif
+/*
+ * High 16 bits of the 32-bit product of two 16-bit values
+ *
+ * Built from four 8x8 products so each one is a single MULWF
+ * rather than a call to the 32-bit multiply.
+ */
+static unsigned int MulHigh(unsigned int x, unsigned int m)
+{
+    unsigned char xl, xh, ml, mh;
+    unsigned int Low, Mid1, Mid2, High;
+
+    xl = (unsigned char)x;
+    xh = (unsigned char)(x >> 8);
+    ml = (unsigned char)m;
+    mh = (unsigned char)(m >> 8);
+    Low  = (unsigned int)xl * ml;
+    Mid1 = (unsigned int)xl * mh;
+    Mid2 = (unsigned int)xh * ml;
+    High = (unsigned int)xh * mh;
+    Low = (Low >> 8) + (Mid1 & 0xFF) + (Mid2 & 0xFF);
+    High += (Mid1 >> 8) + (Mid2 >> 8) + (Low >> 8);
+    return High;
+}
+/*
+ * Convert a pulse width in TIMER3 counts to distance
+ *
+ * Millimetres with SENSOR_UNITS_MM, else the same result as
+ * (Ticks / SENSOR_TICKS_PER_UNIT) clamped to SENSOR_MAX_UNITS.
+ * Neither calls the library divide.
+ */
+static unsigned int SensorDistance(unsigned int Ticks)
+{
+#if SENSOR_UNITS_MM
+    if (Ticks >= SENSOR_RANGE_TICKS)
+        return SENSOR_RANGE_MM;
+    return MulHigh(Ticks, SENSOR_MM_SCALE);
+#else
+    unsigned int high;
+
+    if (Ticks >= SENSOR_MAX_TICKS)
+        return SENSOR_MAX_UNITS;
+    high = MulHigh(Ticks, SENSOR_RECIP);
+    /* (Ticks + high) / 2 without the 17th bit of the sum */
+    return (((Ticks ^ high) >> 1) + (Ticks & high)) >> (SENSOR_RECIP_SHIFT - 17);
+#endif
+}
+/*
+ * Read the 32-bit TIMER1 time, call from the ISR only
+ *
+ * An overflow that happened since the ISR started is not in
+ * timer1High yet, the pending TMR1IF and a small count show it.
+ */
+static unsigned long ReadTime(void)
+{
+    unsigned int count;
+    unsigned int high;
+
+    count = TMR1;
+    high = timer1High;
+    if(PIR1bits.TMR1IF && (count < 0x8000))
+        high++;
+    return ((unsigned long)high << 16) | count;
+}
+#if SENSOR_MEDIAN || SENSOR_IIR_SHIFT
+/*
+ * Read TIMER1 from main
+ *
+ * TMR1H is latched when TMR1L is read. The ISR reads TIMER1 as
+ * well, one that runs between the two byte reads of main latches
+ * TMR1H again and the count tears, so interrupts are off for it.
+ */
+static unsigned int ReadTimer1(void)
+{
+    unsigned char gie;
+    unsigned int count;
+
+    gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    count = TMR1;
+    INTCONbits.GIE = gie;
+    return count;
+}
+#endif
+#if ISR_STATS
+/*
+ * Clear the ISR stats, call with the high priority interrupt off
+ */
+static void IsrStatsReset(void)
+{
+    isrStats.count = 0;
+    isrStats.timeMin = 0xFFFF;
+    isrStats.timeMax = 0;
+    isrStats.timeSum = 0;
+    isrStats.latencyCount = 0;
+    isrStats.latencyMin = 0xFFFF;
+    isrStats.latencyMax = 0;
+    isrStats.latencySum = 0;
+}
+/*
+ * Add one run of the high priority ISR to the stats, call from
+ * the ISR only
+ *
+ * Entry and exit are TIMER0 counts, Trig is set when the run
+ * ended a trigger pulse. The ISR may have been entered for some
+ * other interrupt just before the TIMER2 match, that latency is
+ * taken as 0.
+ */
+static void IsrStatsUpdate(unsigned int Entry, unsigned int Exit, unsigned char Trig)
+{
+    unsigned int time;
+
+    time = Exit - Entry;
+    isrStats.count++;
+    isrStats.timeSum += time;
+    if(time < isrStats.timeMin) isrStats.timeMin = time;
+    if(time > isrStats.timeMax) isrStats.timeMax = time;
+    if(Trig)
+    {
+        time = Entry - isrTrigDue;
+        if(time & 0x8000)
+            time = 0;
+        isrStats.latencyCount++;
+        isrStats.latencySum += time;
+        if(time < isrStats.latencyMin) isrStats.latencyMin = time;
+        if(time > isrStats.latencyMax) isrStats.latencyMax = time;
+    }
+}
+#endif
+#if SENSOR_CAPTURE_CCP
+/*
+ * Arm a CCP module for the rising edge when its sensor is in the
+ * group, take the falling edge after it and hand the width on.
+ *
+ * One TIMER5 count is CCP_T5_SHIFT bits of TIMER3 counts. When
+ * TIMER5 moved more than half a TIMER3 wrap past the width the
+ * pulse wrapped TIMER3, the TIMER5 reads are a few cycles behind
+ * the captures which is far inside that margin.
+ */
+#define CCP_T5_SHIFT (3 - SENSOR_T3CKPS)
+#define CCP_WRAPPED(width, t5) ((t5) > ((width) >> CCP_T5_SHIFT) + (32768U >> CCP_T5_SHIFT))
+
+#define CCP_ARM(n, IE, IF) \
+    if(ccpPending & (1<<((n)-1))) \
+    { \
+        CCP##n##CON = CCP_CAPTURE_RISE; \
+        IF = 0; \
+        IE = 1; \
+    }
+
+#define CCP_EDGE(n, IE, IF) \
+    if(IE) if(IF) \
+    { \
+        IF = 0; \
+        if(CCP##n##CON == CCP_CAPTURE_RISE) \
+        { \
+            ccpStart[(n)-1] = CCPR##n; \
+            ccpStart5[(n)-1] = TMR5; \
+            CCP##n##CON = CCP_CAPTURE_FALL; \
+            IF = 0; /* the mode change can set the flag */ \
+        } \
+        else \
+        { \
+            width = CCPR##n - ccpStart[(n)-1]; \
+            if(CCP_WRAPPED(width, (unsigned int)(TMR5 - ccpStart5[(n)-1]))) \
+                width = 0xFFFF; /* SensorDistance clamps it */ \
+            IE = 0; \
+            CCP##n##CON = 0; \
+            CaptureDone((n)-1, width); \
+        } \
+    }
+
+/*
+ * Turn off the capture on all CCP modules
+ */
+static void CcpStop(void)
+{
+    PIE1bits.CCP1IE = 0;
+    PIE2bits.CCP2IE = 0;
+    PIE4bits.CCP3IE = 0;
+    PIE4bits.CCP4IE = 0;
+    PIE4bits.CCP5IE = 0;
+    CCP1CON = 0;
+    CCP2CON = 0;
+    CCP3CON = 0;
+    CCP4CON = 0;
+    CCP5CON = 0;
+}
+#endif
 /*
  * Select next sensor
+ *
+ * Switch the multiplexer to the sensor group, arm the TIMER3 gate
+ * or the CCP modules for its pulses and raise its trigger. The
+ * trigger address was set up while the last pulse was measured.
+ * TIMER2 ends the trigger pulse and then sets up the address of
+ * the group after it.
+ */
+void triggerSensor(int polledGroup)
+{
+#if SENSOR_CAPTURE_CCP
+    unsigned char count;
+#endif
+
+    MUX_SEL_LAT = (MUX_SEL_LAT & ~MUX_SEL_MASK) | ((polledGroup << MUX_SEL_SHIFT) & MUX_SEL_MASK);
+
+#if SENSOR_CAPTURE_CCP
+    count = SENSOR_SAMPLE_SIZE - polledSensor;
+    if(count > SENSOR_GROUP_SIZE)
+        count = SENSOR_GROUP_SIZE;
+    ccpPending = (1 << count) - 1;
+    CCP_ARM(1, PIE1bits.CCP1IE, PIR1bits.CCP1IF)
+    CCP_ARM(2, PIE2bits.CCP2IE, PIR2bits.CCP2IF)
+    CCP_ARM(3, PIE4bits.CCP3IE, PIR4bits.CCP3IF)
+    CCP_ARM(4, PIE4bits.CCP4IE, PIR4bits.CCP4IF)
+    CCP_ARM(5, PIE4bits.CCP5IE, PIR4bits.CCP5IF)
+#else
+    TMR3 = 0; // Clear the timer.
+    PIR2bits.TMR3IF = 0; /* set when a pulse wraps TIMER3 */
+    T3GCONbits.T3GGO_nDONE = 1; /* Re-enable single-pulse capture. */
+#endif
+
+    TRIG = 1;
+    TMR2 = 0;
+    T2CONbits.TMR2ON = 1;
+#if ISR_STATS
+    ISR_STATS_READ(isrTrigDue);
+    isrTrigDue += TRIG_PULSE_CYCLES;
+#endif
+
+    T5CONbits.TMR5ON = 0; /* restart the echo timeout */
+    TMR5H = (unsigned char)((65536L - SENSOR_TIMEOUT_COUNTS) >> 8);
+    TMR5L = (unsigned char)(65536L - SENSOR_TIMEOUT_COUNTS);
+    PIR5bits.TMR5IF = 0;
+    T5CONbits.TMR5ON = 1;
+
+    polledGroup++;
+    if(polledGroup >= SENSOR_GROUPS)
+        polledGroup = 0;
+    trigAdrNext = (polledGroup << TRIG_ADR_SHIFT) & TRIG_ADR_MASK;
+}
+/*
+ * Move on to the next sensor group and publish the frame after
+ * the last one, call from the ISR only
+ */
+static void SensorNext(void)
+{
+    unsigned long now;
+
+    // Start the next measurement.
+    polledSensor += SENSOR_GROUP_SIZE;
+    polledGroup++;
+    if(polledSensor >= SENSOR_SAMPLE_SIZE)
+    {
+        polledSensor = 0;
+        polledGroup = 0;
+        /* publish the frame, the next round fills the other one */
+        if(++sensorSeq == 0) sensorSeq = 1; /* 0 is kept for no frame */
+        sensorFrame[~sensorPublished & 1].seq = sensorSeq;
+        now = ReadTime();
+        sensorFrame[~sensorPublished & 1].roundTime = now - roundStart;
+        roundStart = now;
+        sensorPublished++;
+#if !SENSOR_FREE_RUN
+        captureOn = 0; /* stop polling when buffer full */
+        T5CONbits.TMR5ON = 0;
+#endif
+    }
+    if(captureOn)
+        triggerSensor(polledGroup);
+}
+#if SENSOR_CAPTURE_CCP
+/*
+ * Store the pulse width of one sensor of the group, move on when
+ * the whole group is done, call from the ISR only
+ */
+static void CaptureDone(unsigned char channel, unsigned int width)
+{
+    /* The frame being filled is the one not published last */
+    sensorFrame[~sensorPublished & 1].sensorData[polledSensor + channel] = SensorDistance(width);
+    ccpPending &= ~(1 << channel);
+    if(ccpPending == 0)
+        SensorNext();
+}
+/*
+ * Give up on the sensors of the group without a pulse, call from
+ * the ISR only
+ */
+static void CaptureTimeout(void)
+{
+    unsigned char channel;
+
+    CcpStop();
+    for(channel = 0; channel < SENSOR_GROUP_SIZE; channel++)
+    {
+        if(ccpPending & (1 << channel))
+        {
+            sensorFrame[~sensorPublished & 1].sensorData[polledSensor + channel] = SENSOR_NO_ECHO;
+            sensorTimeouts[polledSensor + channel]++;
+        }
+    }
+    ccpPending = 0;
+    SensorNext();
+}
+#else
+/*
+ * Store the result of the sensor and start the next one, call
+ * from the ISR only
  */
-void triggerSensor(int polledSensor)
+static void SensorDone(unsigned int value)
 {
-    /*
-     * This is a dummy function.
-     *
-     * It should set the input multiplexer to
-     * select the next sensor pulse input for
-     * the TIMER3 gate.
-     */
+    /* The frame being filled is the one not published last */
+    sensorFrame[~sensorPublished & 1].sensorData[polledSensor] = value;
+    SensorNext();
 }
+#endif
 /*
  * Interrupt handlers
  */
 void interrupt InterruptHandlerHigh( void )
 {
+#if SENSOR_CAPTURE_CCP
+    unsigned int width;
+#endif
+#if ISR_STATS
+    unsigned int isrEntry;
+    unsigned int isrExit;
+    unsigned char isrTrig = 0;
+
+    ISR_STATS_READ(isrEntry);
+    ISR_STATS_PIN = 1;
+#endif
+
     /* Note: This clumsy syntax generates better code with XC8 */
+    if(PIE1bits.TMR2IE) if(PIR1bits.TMR2IF)
+    {
+        /* End of the trigger pulse, set up the next trigger address */
+        PIR1bits.TMR2IF = 0;
+#if ISR_STATS
+        isrTrig = 1;
+#endif
+        TRIG = 0;
+        T2CONbits.TMR2ON = 0;
+        TRIG_ADR_LAT = (TRIG_ADR_LAT & ~TRIG_ADR_MASK) | trigAdrNext;
+    }
+#if SENSOR_CAPTURE_CCP
+    CCP_EDGE(1, PIE1bits.CCP1IE, PIR1bits.CCP1IF)
+    CCP_EDGE(2, PIE2bits.CCP2IE, PIR2bits.CCP2IF)
+    CCP_EDGE(3, PIE4bits.CCP3IE, PIR4bits.CCP3IF)
+    CCP_EDGE(4, PIE4bits.CCP4IE, PIR4bits.CCP4IF)
+    CCP_EDGE(5, PIE4bits.CCP5IE, PIR4bits.CCP5IF)
+#else
     if(PIE3bits.TMR3GIE) if(PIR3bits.TMR3GIF)
     {
         PIR3bits.TMR3GIF = 0;
         // Pulse captured. Calculate the new distance.
-        // We will only measure up to 255cm.
+        // We will only measure up to SENSOR_MAX_VALUE.
         /*
          * Note 0:
          *
@@ -105,27 +780,51 @@ void interrupt InterruptHandlerHigh( void )
 
         /* Note 1:
          *
-         * Statement uses an integer divide in the ISR.
-         * 
-         * This will make a call to the fixed point math
-         * library. A divide takes a lot of cycles.
+         * An integer divide here would call the fixed point
+         * math library and take hundreds of cycles. The
+         * conversion is a reciprocal multiply instead, see
+         * SensorDistance.
+         */
+        /* Note 2:
          *
-         * Do you really want to do this here?
+         * TIMER3 wraps on a pulse longer than 65536 counts, which
+         * can end before SENSOR_TIMEOUT_US. TMR3IF shows the wrap
+         * and the sensor reads as far as it can.
          */
-        sensorData[polledSensor] = ((TMR3 < 255*58) ? (TMR3 / 58) : 255);
-
-        // Start the next measurement.
-        polledSensor++;
-        if(polledSensor >= SENSOR_SAMPLE_SIZE)
+        if(captureOn)
         {
-            polledSensor = 0;
-            PIE3bits.TMR3GIE = 0; /* stop polling when buffer full */
+            if(PIR2bits.TMR3IF)
+                SensorDone(SENSOR_MAX_VALUE);
+            else
+                SensorDone(SensorDistance(TMR3));
         }
-        triggerSensor(polledSensor);
-
-        TMR3 = 0; // Clear the timer.
-        T3GCONbits.T3GGO_nDONE = 1; /* Re-enable single-pulse capture. */
     }
+#endif
+    if(PIE5bits.TMR5IE) if(PIR5bits.TMR5IF)
+    {
+        PIR5bits.TMR5IF = 0;
+        if(captureOn)
+        {
+            /* No echo in time, give up on this sensor */
+#if SENSOR_CAPTURE_CCP
+            CaptureTimeout();
+#else
+            T3GCONbits.T3GGO_nDONE = 0;
+            sensorTimeouts[polledSensor]++;
+            SensorDone(SENSOR_NO_ECHO);
+#endif
+        }
+    }
+    if(PIE1bits.TMR1IE) if(PIR1bits.TMR1IF)
+    {
+        PIR1bits.TMR1IF = 0;
+        timer1High++;
+    }
+#if ISR_STATS
+    ISR_STATS_PIN = 0;
+    ISR_STATS_READ(isrExit);
+    IsrStatsUpdate(isrEntry, isrExit, isrTrig);
+#endif
 }
 /*  
  * Initialize this PIC18F23K22
@@ -176,13 +875,24 @@ void PIC_Init(void)
 void TIMER3_Init(void)
 {
     PIE3bits.TMR3GIE = 0;
+#if SENSOR_CAPTURE_CCP
+    TRISCbits.TRISC2 = 1;   /* make the CCP pins inputs */
+    TRISCbits.TRISC1 = 1;
+    TRISBbits.TRISB5 = 1;
+    TRISBbits.TRISB0 = 1;
+    TRISAbits.TRISA4 = 1;
+    CcpStop();
+    CCPTMRS0 = 0x49;        /* CCP1, CCP2 and CCP3 capture TIMER3 */
+    CCPTMRS1 = 0x05;        /* CCP4 and CCP5 capture TIMER3 */
+#else
     TRISCbits.TRISC0 = 1;   /* make RC0 an input for the TIMER3 gate */
+#endif
 
     T3CON  = (0<<_T3CON_TMR3ON_POSITION)
            | (0<<_T3CON_T3RD16_POSITION)
            | (0<<_T3CON_nT3SYNC_POSITION)
            | (0<<_T3CON_T3SOSCEN_POSITION )
-           | (0<<_T3CON_T3CKPS_POSITION)
+           | (SENSOR_T3CKPS<<_T3CON_T3CKPS_POSITION)
            | (0<<_T3CON_TMR3CS_POSITION);
 
     T3GCON = (0<<_T3GCON_T3GSS_POSITION)
@@ -190,35 +900,374 @@ void TIMER3_Init(void)
            | (0<<_T3GCON_T3GGO_nDONE_POSITION)
            | (0<<_T3GCON_T3GTM_POSITION)
            | (1<<_T3GCON_T3GPOL_POSITION)
-           | (1<<_T3GCON_TMR3GE_POSITION);
+           | ((!SENSOR_CAPTURE_CCP)<<_T3GCON_TMR3GE_POSITION);
 
     TMR3 = 0;
+#if SENSOR_CAPTURE_CCP
+    IPR1bits.CCP1IP = 1;
+    IPR2bits.CCP2IP = 1;
+    IPR4bits.CCP3IP = 1;
+    IPR4bits.CCP4IP = 1;
+    IPR4bits.CCP5IP = 1;
+#else
     IPR3bits.TMR3GIP = 1;
     PIR3bits.TMR3GIF = 0;
     PIE3bits.TMR3GIE = 1;
+#endif
     INTCONbits.PEIE = 1;
     T3CONbits.TMR3ON = 1;
 }
+/*
+ *  Setup TIMER2 to time the trigger pulse, TIMER5 for
+ *  the echo timeout and TIMER1 as the free running
+ *  round timer
+ */
+void TIMER_Init(void)
+{
+    PIE1bits.TMR1IE = 0;
+    PIE1bits.TMR2IE = 0;
+
+    T2CON  = 0;             /* 1:1 prescale and postscale, off */
+    TMR2 = 0;
+    PR2 = TRIG_PULSE_CYCLES - 1;
+
+    T1CON  = (0<<_T1CON_TMR1ON_POSITION)
+           | (1<<_T1CON_T1RD16_POSITION)
+           | (0<<_T1CON_nT1SYNC_POSITION)
+           | (0<<_T1CON_T1SOSCEN_POSITION )
+           | (3<<_T1CON_T1CKPS_POSITION)
+           | (0<<_T1CON_TMR1CS_POSITION);
+    TMR1 = 0;
+    timer1High = 0;
+
+    T5CON  = (0<<_T5CON_TMR5ON_POSITION)
+           | (1<<_T5CON_T5RD16_POSITION)
+           | (0<<_T5CON_nT5SYNC_POSITION)
+           | (0<<_T5CON_T5SOSCEN_POSITION )
+           | (3<<_T5CON_T5CKPS_POSITION)
+           | (0<<_T5CON_TMR5CS_POSITION);
+    IPR5bits.TMR5IP = 1;
+    PIR5bits.TMR5IF = 0;
+    PIE5bits.TMR5IE = 1;
+
+    PIR1bits.TMR1IF = 0;
+    PIR1bits.TMR2IF = 0;
+    PIE1bits.TMR1IE = 1;
+    PIE1bits.TMR2IE = 1;
+    INTCONbits.PEIE = 1;
+    T1CONbits.TMR1ON = 1;
+
+#if ISR_STATS
+    ISR_STATS_TRIS = 0;
+    ISR_STATS_PIN = 0;
+    INTCONbits.TMR0IE = 0;
+    T0CON  = (0<<_T0CON_TMR0ON_POSITION)
+           | (0<<_T0CON_T08BIT_POSITION)
+           | (0<<_T0CON_T0CS_POSITION)
+           | (1<<_T0CON_PSA_POSITION);
+    TMR0H = 0;
+    TMR0L = 0;
+    IsrStatsReset();
+    T0CONbits.TMR0ON = 1;
+#endif
+}
+/*
+ *  Setup the sensor multiplexer and trigger decoder
+ */
+void MUX_Init(void)
+{
+    MUX_SEL_TRIS &= ~MUX_SEL_MASK;
+    TRIG_ADR_TRIS &= ~TRIG_ADR_MASK;
+    TRIG_TRIS = 0;
+    TRIG = 0;
+    MUX_SEL_LAT &= ~MUX_SEL_MASK;
+    TRIG_ADR_LAT &= ~TRIG_ADR_MASK;
+}
 /*
  * Start capture of sensor data
  */
 void StartSensorCapture(void)
 {
-    PIE3bits.TMR3GIE = 0;
+    INTCONbits.GIE = 0;
+    captureOn = 0;
+#if SENSOR_CAPTURE_CCP
+    CcpStop();
+#else
     T3GCONbits.T3GGO_nDONE = 0;
+    PIR3bits.TMR3GIF = 0;
+#endif
+    T5CONbits.TMR5ON = 0;
     polledSensor = 0;
-    TMR3 = 0;
-    T3GCONbits.T3GGO_nDONE = 1; /* Enable single-pulse capture. */
-    PIE3bits.TMR3GIE = 1;
+    polledGroup = 0;
+    T1CONbits.TMR1ON = 0; /* restart the round timer */
+    TMR1 = 0;
+    timer1High = 0;
+    roundStart = 0;
+    PIR1bits.TMR1IF = 0;
+    T1CONbits.TMR1ON = 1;
+    INTCONbits.GIE = 1;
+
+    while(TRIG); /* let a trigger pulse from the last round end */
+    TRIG_ADR_LAT = (TRIG_ADR_LAT & ~TRIG_ADR_MASK);
+    captureOn = 1;
+    triggerSensor(polledGroup); /* Enable capture. */
+}
+#if STREAM_ENABLE
+/*
+ *  Setup EUSART1 to send the frame stream
+ */
+void STREAM_Init(void)
+{
+    PIE1bits.TX1IE = 0;
+    TRISCbits.TRISC6 = 1;       /* EUSART drives TXD1 */
+    TRISCbits.TRISC7 = 1;
+
+    SPBRGH1 = (unsigned char)(STREAM_BRG >> 8);
+    SPBRG1  = (unsigned char)(STREAM_BRG);
+    BAUDCON1 = 0;
+    BAUDCON1bits.BRG16 = 1;
+    TXSTA1 = 0;
+    TXSTA1bits.BRGH = 1;
+    RCSTA1 = 0;
+    RCSTA1bits.SPEN = 1;
+    TXSTA1bits.TXEN = 1;
+}
+/*
+ * CRC-8 with polynomial 0x07 for each value of a nibble, the
+ * table is run twice per byte.
+ */
+static const unsigned char crc8Nibble[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+static unsigned char Crc8(unsigned char crc, unsigned char data)
+{
+    crc = crc8Nibble[(crc >> 4) ^ (data >> 4)] ^ (crc << 4);
+    crc = crc8Nibble[(crc >> 4) ^ (data & 0x0F)] ^ (crc << 4);
+    return crc;
 }
+/*
+ * Send a frame as a stream packet
+ *
+ * Returns when the last byte is in the EUSART, about ten bit
+ * times for each byte of the packet.
+ */
+void StreamFrame(SensorFrame_t *pFrame)
+{
+    unsigned char index;
+    unsigned char crc;
+    unsigned char value;
+
+    streamPacket[0] = (unsigned char)(STREAM_SYNC >> 8);
+    streamPacket[1] = (unsigned char)(STREAM_SYNC);
+    streamPacket[2] = (unsigned char)(pFrame->seq >> 8);
+    streamPacket[3] = (unsigned char)(pFrame->seq);
+    crc = Crc8(0, streamPacket[2]);
+    crc = Crc8(crc, streamPacket[3]);
+#if SENSOR_UNITS_MM
+    for(index = 0; index < SENSOR_SAMPLE_SIZE; index++)
+    {
+        value = (unsigned char)(pFrame->sensorData[index] >> 8);
+        streamPacket[4 + 2*index] = value;
+        crc = Crc8(crc, value);
+        value = (unsigned char)(pFrame->sensorData[index]);
+        streamPacket[5 + 2*index] = value;
+        crc = Crc8(crc, value);
+    }
+#else
+    for(index = 0; index < SENSOR_SAMPLE_SIZE; index++)
+    {
+        if(pFrame->sensorData[index] == SENSOR_NO_ECHO)
+            value = 0xFF;
+        else if(pFrame->sensorData[index] >= 0xFE)
+            value = 0xFE;
+        else
+            value = (unsigned char)pFrame->sensorData[index];
+        streamPacket[4 + index] = value;
+        crc = Crc8(crc, value);
+    }
+#endif
+    streamPacket[STREAM_PACKET_SIZE - 1] = crc;
+
+    for(index = 0; index < STREAM_PACKET_SIZE; index++)
+    {
+        while(!PIR1bits.TX1IF); /* TX1IF is set while TXREG1 is empty */
+        TXREG1 = streamPacket[index];
+    }
+}
+#endif
+/*
+ * Copy the newest complete frame of sensor data
+ *
+ * Interrupts stay on. The ISR fills the other frame buffer, the
+ * copy is only taken again when a round finished while it was
+ * being made and the buffer may have been reused.
+ *
+ * Returns the round number of the frame, 0 when no round has
+ * finished yet.
+ */
+unsigned int GetSensorFrame(SensorFrame_t *pCopy)
+{
+    unsigned char published;
+    unsigned char index;
+    volatile SensorFrame_t *pFrame;
+
+    do
+    {
+        published = sensorPublished;
+        pFrame = &sensorFrame[published & 1];
+        pCopy->seq = pFrame->seq;
+        pCopy->roundTime = pFrame->roundTime;
+        for(index = 0; index < SENSOR_SAMPLE_SIZE; index++)
+        {
+            pCopy->sensorData[index] = pFrame->sensorData[index];
+        }
+    } while(published != sensorPublished);
+
+    return pCopy->seq;
+}
+#if ISR_STATS
+/*
+ * Copy the high priority ISR stats
+ *
+ * The mean time is timeSum / count and the mean latency is
+ * latencySum / latencyCount, in FCYC cycles. Interrupts are off
+ * for the copy. Set Reset to clear the stats after the copy, to
+ * compare the ISR before and after a change.
+ */
+void GetIsrStats(IsrStats_t *pCopy, unsigned char Reset)
+{
+    unsigned char gie;
+
+    gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    *pCopy = isrStats;
+    if(Reset)
+        IsrStatsReset();
+    INTCONbits.GIE = gie;
+}
+#endif
+#if SENSOR_MEDIAN || SENSOR_IIR_SHIFT
+/*
+ * Filter state of each sensor
+ */
+#if SENSOR_MEDIAN
+unsigned int filterHistory[SENSOR_MEDIAN][SENSOR_SAMPLE_SIZE];
+unsigned char filterNext = 0;   /* row of filterHistory for the next round */
+#endif
+#if SENSOR_IIR_SHIFT
+unsigned int filterIir[SENSOR_SAMPLE_SIZE];
+#endif
+unsigned char filterPrimed = 0;
+volatile unsigned int filterTimeMax = 0;    /* longest FilterFrame in ROUND_TIME_US counts */
+#if SENSOR_MEDIAN
+/*
+ * Median of the last SENSOR_MEDIAN readings of a sensor
+ */
+static unsigned int Median(unsigned char sensor)
+{
+#if SENSOR_MEDIAN == 3
+    unsigned int a, b, c;
+
+    a = filterHistory[0][sensor];
+    b = filterHistory[1][sensor];
+    c = filterHistory[2][sensor];
+    if(a > b)
+    {
+        if(b >= c) return b;
+        return (a > c) ? c : a;
+    }
+    if(a >= c) return a;
+    return (b > c) ? c : b;
+#else
+    unsigned int v[SENSOR_MEDIAN];
+    unsigned int t;
+    unsigned char i, j;
+
+    /* insertion sort, at most ten compares for five readings */
+    for(i = 0; i < SENSOR_MEDIAN; i++)
+    {
+        t = filterHistory[i][sensor];
+        for(j = i; j && (v[j-1] > t); j--)
+            v[j] = v[j-1];
+        v[j] = t;
+    }
+    return v[SENSOR_MEDIAN/2];
+#endif
+}
+#endif
+/*
+ * Filter a new frame in place
+ *
+ * Integer adds, compares and shifts only. The first frame fills
+ * the history and the IIR state so the output starts there.
+ */
+void FilterFrame(SensorFrame_t *pFrame)
+{
+    unsigned char sensor;
+    unsigned int value;
+#if SENSOR_MEDIAN
+    unsigned char row;
+#endif
+
+    for(sensor = 0; sensor < SENSOR_SAMPLE_SIZE; sensor++)
+    {
+        value = pFrame->sensorData[sensor];
+#if SENSOR_MEDIAN
+        if(!filterPrimed)
+        {
+            for(row = 0; row < SENSOR_MEDIAN; row++)
+                filterHistory[row][sensor] = value;
+        }
+        filterHistory[filterNext][sensor] = value;
+        value = Median(sensor);
+#endif
+#if SENSOR_IIR_SHIFT
+        if(value != SENSOR_NO_ECHO)
+        {
+            if(!filterPrimed || (filterIir[sensor] == SENSOR_NO_ECHO))
+                filterIir[sensor] = value << SENSOR_IIR_SHIFT;
+            else
+                filterIir[sensor] += (int)(value - (filterIir[sensor] >> SENSOR_IIR_SHIFT));
+            value = (filterIir[sensor] + (1 << (SENSOR_IIR_SHIFT-1))) >> SENSOR_IIR_SHIFT;
+        }
+        else if(!filterPrimed)
+        {
+            filterIir[sensor] = SENSOR_NO_ECHO;
+        }
+#endif
+        pFrame->sensorData[sensor] = value;
+    }
+#if SENSOR_MEDIAN
+    if(++filterNext >= SENSOR_MEDIAN)
+        filterNext = 0;
+#endif
+    filterPrimed = 1;
+}
+#endif
 /*  
  * This is the main application loop
  */
 void main (void)
 {
+    SensorFrame_t frame;
+    unsigned int lastSeq = 0;
+#if SENSOR_MEDIAN || SENSOR_IIR_SHIFT
+    unsigned int filterStart;
+    unsigned int filterTime;
+#endif
+#if ISR_STATS
+    IsrStats_t isr;
+#endif
 
     PIC_Init();
+    MUX_Init();
+    TIMER_Init();
     TIMER3_Init();
+#if STREAM_ENABLE
+    STREAM_Init();
+#endif
 
     /* Enable interrupt system */
     INTCONbits.GIE = 1;
@@ -226,10 +1275,38 @@ void main (void)
     /* Capture some sensor data */
     StartSensorCapture();
 
+#if !SENSOR_FREE_RUN
     /* wait for capture to complete */
-    while(PIE3bits.TMR3GIE); 
+    while(captureOn); 
+#endif
 
     for(;;)
     {
+        if(GetSensorFrame(&frame) != lastSeq)
+        {
+            /* A new round is in frame, rounds lastSeq+1 to frame.seq-1 were missed */
+            lastSeq = frame.seq;
+            /* Round timing report in ROUND_TIME_US counts */
+            if(frame.roundTime < roundTimeMin) roundTimeMin = frame.roundTime;
+            if(frame.roundTime > roundTimeMax) roundTimeMax = frame.roundTime;
+#if SENSOR_MEDIAN || SENSOR_IIR_SHIFT
+            /* Filter time report in ROUND_TIME_US counts */
+            filterStart = ReadTimer1();
+            FilterFrame(&frame);
+            filterTime = ReadTimer1() - filterStart;
+            if(filterTime > filterTimeMax) filterTimeMax = filterTime;
+#endif
+#if STREAM_ENABLE
+            StreamFrame(&frame);
+#endif
+#if ISR_STATS
+            /* ISR time and trigger latency report in FCYC cycles */
+            GetIsrStats(&isr, 0);
+            if(isr.count)
+                isrTimeMean = isr.timeSum / isr.count;
+            if(isr.latencyCount)
+                isrLatencyMean = isr.latencySum / isr.latencyCount;
+#endif
+        }
     } 
 }
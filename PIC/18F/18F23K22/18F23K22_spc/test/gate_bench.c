@@ -0,0 +1,256 @@
+/*
+ * Capture latency bench on the model
+ *
+ *   gate_bench [-q] [-c cycles] [-t ms] trace
+ *
+ * Runs main.c, built for the host with the model, on a pulse
+ * trace for -t milliseconds, 1000 by default. Each capture is
+ * listed with the cycles from the end of the pulse, TMR3GIF in
+ * gate mode or the falling edge capture in CCP mode, to the start
+ * of the ISR run that took it and to the flag cleared. -q lists
+ * only the summary. -c sets the cycles for each basic block of
+ * main.c, see model.h.
+ *
+ * The newest frame and the last stream packet are checked against
+ * the trace when it has one pulse for each sensor. The exit code
+ * is 1 when they do not match.
+ *
+ * Built with BENCH_ISR_STATS, against main.c with ISR_STATS, the
+ * stats main.c keeps with TIMER0 are listed as well and checked
+ * against what the model saw.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xc.h"
+#include "model.h"
+
+/* main.c defaults for the 8-bit scale */
+#define TICKS_PER_UNIT  58
+#define MAX_UNITS       255
+#define NO_ECHO         0xFFFF
+#define TIMEOUT_US      30000UL
+#define PACKET_SIZE     (2+2+MODEL_SENSORS+1)
+
+#ifdef BENCH_ISR_STATS
+/* main.c IsrStats_t as built for the host */
+typedef struct {
+    unsigned long count;
+    unsigned short timeMin;
+    unsigned short timeMax;
+    unsigned long timeSum;
+    unsigned long latencyCount;
+    unsigned short latencyMin;
+    unsigned short latencyMax;
+    unsigned long latencySum;
+} BenchIsrStats_t;
+
+extern BenchIsrStats_t isrStats;
+extern volatile unsigned short isrTimeMean;
+extern volatile unsigned short isrLatencyMean;
+
+/*
+ * main.c takes the trigger latency from the TIMER0 count read
+ * just before TIMER2 is started, a few basic blocks earlier than
+ * the model, and its own ISR_STATS_READ and pin write are in the
+ * time. Both must agree within that.
+ */
+static int IsrStatsCheck(unsigned long Trigs, unsigned long TrigMax)
+{
+    unsigned long slack = 8 * model.bbCycles;
+    int bad = 0;
+
+    printf("main.c ISR stats: runs %lu, time min %u max %u mean %u, trigger latency min %u max %u mean %u cycles\n",
+        isrStats.count, isrStats.timeMin, isrStats.timeMax, isrTimeMean,
+        isrStats.latencyMin, isrStats.latencyMax, isrLatencyMean);
+    printf("model: runs %lu, longest %lu, trigger pulse ends %lu, worst entry %lu cycles\n",
+        model.isrRuns, model.isrMax, Trigs, TrigMax);
+    if((isrStats.count + 1 < model.isrRuns) || (isrStats.count > model.isrRuns))
+        bad = 1;
+    if((isrStats.latencyCount + 1 < Trigs) || (isrStats.latencyCount > Trigs))
+        bad = 1;
+    if(isrStats.timeMax > model.isrMax)
+        bad = 1;
+    if((isrStats.latencyMax + slack < TrigMax) || (isrStats.latencyMax > TrigMax + slack))
+        bad = 1;
+    if(!isrTimeMean || (isrTimeMean < isrStats.timeMin) || (isrTimeMean > isrStats.timeMax))
+        bad = 1;
+    if(bad)
+        printf("FAIL: ISR stats do not agree with the model\n");
+    return bad;
+}
+#endif
+
+static unsigned char Crc8(unsigned char Crc, unsigned char Data)
+{
+    int bit;
+
+    Crc ^= Data;
+    for(bit = 0; bit < 8; bit++)
+        Crc = (Crc & 0x80) ? (unsigned char)((Crc << 1) ^ 0x07) : (unsigned char)(Crc << 1);
+    return Crc;
+}
+
+/*
+ * Value the trace should give for a sensor, -1 when it is too
+ * close to the timeout to say
+ */
+static long Expected(int Sensor)
+{
+    ModelPulse_t *pulse;
+    unsigned long long ticks;
+
+    if(model.traceSize[Sensor] == 0)
+        return NO_ECHO;
+    pulse = &model.trace[Sensor][0];
+    if(pulse->widthUs == 0)
+        return NO_ECHO;
+    if(pulse->delayUs + pulse->widthUs > TIMEOUT_US + 500)
+        return NO_ECHO;
+    if(pulse->delayUs + pulse->widthUs > TIMEOUT_US - 500)
+        return -1;
+    ticks = MODEL_US(pulse->widthUs) >> T3CONbits.T3CKPS;
+    if(ticks >= 65536)
+        return MAX_UNITS;
+    return (ticks / TICKS_PER_UNIT > MAX_UNITS) ? MAX_UNITS : (long)(ticks / TICKS_PER_UNIT);
+}
+
+static int Near(long Got, long Want)
+{
+    if(Want < 0)
+        return 1;
+    if((Want == NO_ECHO) || (Got == NO_ECHO))
+        return Got == Want;
+    return (Got >= Want - 1) && (Got <= Want + 1);
+}
+
+int main(int argc, char *argv[])
+{
+    int quiet = 0;
+    unsigned long ms = 1000;
+    int opt;
+    unsigned long i;
+    unsigned long captures = 0;
+    unsigned long long entrySum = 0, servedSum = 0;
+    unsigned long entryMax = 0, servedMax = 0, worst = 0;
+    unsigned long trigs = 0, trigMax = 0;
+    unsigned long long trigSum = 0;
+    int single = 1;
+    int sensor;
+    int bad = 0;
+    ModelRecord_t *rec;
+    volatile ModelFrame_t *frame;
+    unsigned long packets = 0, crcBad = 0, last = 0;
+    unsigned char crc;
+
+    Model_Reset();
+    while((opt = getopt(argc, argv, "qc:t:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'q': quiet = 1; break;
+        case 'c': model.bbCycles = (unsigned)atoi(optarg); break;
+        case 't': ms = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-q] [-c cycles] [-t ms] trace\n", argv[0]);
+            return 2;
+        }
+    }
+    if((optind >= argc) || Model_LoadTrace(argv[optind]))
+    {
+        fprintf(stderr, "usage: %s [-q] [-c cycles] [-t ms] trace\n", argv[0]);
+        return 2;
+    }
+
+    Model_Run(app_main, MODEL_US(ms * 1000UL));
+
+    printf("%s, %s mode, %lums, %u cycles a basic block\n", argv[optind],
+        T3GCONbits.TMR3GE ? "gate" : "CCP", ms, model.bbCycles);
+    if(!quiet)
+        printf("capture  time_us  sensor  count  entry  served  (cycles)\n");
+    for(i = 0; i < model.records; i++)
+    {
+        rec = &model.record[i];
+        if(rec->kind == MODEL_TRIG)
+        {
+            trigs++;
+            trigSum += rec->entry;
+            if(rec->entry > trigMax) trigMax = rec->entry;
+            continue;
+        }
+        if(!quiet)
+            printf("%7lu %8llu %7u %6u %6lu %7lu\n", captures, rec->set / (MODEL_FCYC / 1000000UL),
+                rec->sensor, rec->count, rec->entry, rec->served);
+        captures++;
+        entrySum += rec->entry;
+        servedSum += rec->served;
+        if(rec->entry > entryMax) { entryMax = rec->entry; worst = i; }
+        if(rec->served > servedMax) servedMax = rec->served;
+    }
+    if(captures)
+    {
+        printf("captures %lu, entry latency mean %llu worst %lu cycles (%lu at %lluus, sensor %u), served mean %llu worst %lu\n",
+            captures, entrySum / captures, entryMax, entryMax, model.record[worst].set / (MODEL_FCYC / 1000000UL),
+            model.record[worst].sensor, servedSum / captures, servedMax);
+    }
+    else
+        printf("captures 0\n");
+    if(trigs)
+        printf("trigger pulse ends %lu, entry latency mean %llu worst %lu cycles\n", trigs, trigSum / trigs, trigMax);
+    printf("triggers %lu, rounds %u, ISR runs %lu, ISR %.1f%% of the time\n", model.triggers,
+        sensorPublished, model.isrRuns, 100.0 * model.isrCycles / model.cycle);
+
+    /* stream packets */
+    for(i = 0; i + PACKET_SIZE <= model.streamSize; i++)
+    {
+        if((model.stream[i] != 0xA5) || (model.stream[i + 1] != 0x5A))
+            continue;
+        crc = 0;
+        for(opt = 2; opt < PACKET_SIZE - 1; opt++)
+            crc = Crc8(crc, model.stream[i + opt]);
+        if(crc != model.stream[i + PACKET_SIZE - 1])
+        {
+            crcBad++;
+            continue;
+        }
+        packets++;
+        last = i;
+        i += PACKET_SIZE - 1;
+    }
+    printf("stream %lu bytes, %lu packets, %lu bad\n", model.streamSize, packets, crcBad);
+#ifdef BENCH_ISR_STATS
+    bad = IsrStatsCheck(trigs, trigMax);
+#endif
+
+    /* results against the trace */
+    for(sensor = 0; sensor < MODEL_SENSORS; sensor++)
+        if(model.traceSize[sensor] > 1)
+            single = 0;
+    if(!single)
+        return bad;
+    if(sensorPublished < 2)
+    {
+        printf("FAIL: fewer than two rounds\n");
+        return 1;
+    }
+    frame = &sensorFrame[sensorPublished & 1];
+    for(sensor = 0; sensor < MODEL_SENSORS; sensor++)
+    {
+        if(!Near(frame->sensorData[sensor], Expected(sensor)))
+        {
+            printf("FAIL: sensor %d read %u, trace gives %ld\n", sensor, frame->sensorData[sensor], Expected(sensor));
+            bad = 1;
+        }
+        if(packets && !Near(model.stream[last + 4 + sensor],
+            (Expected(sensor) == NO_ECHO) ? 0xFF : (Expected(sensor) >= 0xFE) ? 0xFE : Expected(sensor)))
+        {
+            printf("FAIL: sensor %d sent %u, trace gives %ld\n", sensor, model.stream[last + 4 + sensor], Expected(sensor));
+            bad = 1;
+        }
+    }
+    if(!packets || crcBad)
+        bad = 1;
+    printf("%s\n", bad ? "FAIL" : "results match the trace");
+    return bad;
+}
@@ -0,0 +1,389 @@
+/*
+ * Host model of the PIC18F23K22 peripherals main.c uses, see
+ * model.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xc.h"
+#include "model.h"
+
+Model_t model;
+
+/* main.c wiring */
+#define TRIG_PIN    LATCbits.LATC3
+#define MUX_SEL     (LATA & 0x0F)
+#define TRIG_ADR    ((LATB >> 1) & 0x0F)
+#define CCP_MODE    (!T3GCONbits.TMR3GE)    /* main.c gates TIMER3 only without the CCPs */
+#define GROUP_SIZE  (CCP_MODE ? 5 : 1)
+
+/* CCP5CON to CCP1CON capture modes */
+#define CCP_FALL    0x04
+#define CCP_RISE    0x05
+
+/* Single pulse states of the TIMER3 gate */
+#define SPM_IDLE    0   /* T3GGO_nDONE clear */
+#define SPM_ACTIVE  1   /* armed with the gate active, wait for it to end */
+#define SPM_WAIT    2   /* armed, wait for the gate to become active */
+#define SPM_COUNT   3   /* counting until the gate ends */
+
+void Model_Reset(void)
+{
+    memset(&model, 0, sizeof(model));
+    model.bbCycles = MODEL_BB_CYCLES;
+    model.stopAt = ~0ULL;
+    TXREG1 = 0xFFFF;
+    TXSTA1bits.TRMT = 1;
+}
+
+/*
+ * Read a pulse trace, one pulse a line:
+ *
+ *   sensor delay_us width_us
+ *
+ * delay_us is from the TRIG rising edge to the echo, a width of
+ * 0 is no echo. A sensor with more than one line takes them in
+ * turn on each trigger, one with none never echoes. # starts a
+ * comment.
+ */
+int Model_LoadTrace(const char *Path)
+{
+    FILE *file;
+    char line[256];
+    unsigned sensor;
+    unsigned long delay, width;
+    int lineNo = 0;
+
+    file = fopen(Path, "r");
+    if(file == NULL)
+    {
+        perror(Path);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), file))
+    {
+        lineNo++;
+        if(strchr(line, '#'))
+            *strchr(line, '#') = 0;
+        if(strspn(line, " \t\r\n") == strlen(line))
+            continue;
+        if((sscanf(line, "%u %lu %lu", &sensor, &delay, &width) != 3)
+            || (sensor >= MODEL_SENSORS) || (model.traceSize[sensor] >= MODEL_TRACE_MAX))
+        {
+            fprintf(stderr, "%s:%d: bad pulse\n", Path, lineNo);
+            fclose(file);
+            return -1;
+        }
+        model.trace[sensor][model.traceSize[sensor]].delayUs = delay;
+        model.trace[sensor][model.traceSize[sensor]].widthUs = width;
+        model.traceSize[sensor]++;
+    }
+    fclose(file);
+    return 0;
+}
+
+static void Fire(int Sensor)
+{
+    ModelPulse_t *pulse;
+
+    if((Sensor >= MODEL_SENSORS) || (model.traceSize[Sensor] == 0))
+        return;
+    pulse = &model.trace[Sensor][model.traceNext[Sensor]];
+    if(++model.traceNext[Sensor] >= model.traceSize[Sensor])
+        model.traceNext[Sensor] = 0;
+    model.echoEnd[Sensor] = 0;
+    if(pulse->widthUs)
+    {
+        model.echoStart[Sensor] = model.cycle + MODEL_US(pulse->delayUs);
+        model.echoEnd[Sensor] = model.echoStart[Sensor] + MODEL_US(pulse->widthUs);
+    }
+}
+
+static int Echo(int Sensor)
+{
+    return (Sensor < MODEL_SENSORS) && model.echoEnd[Sensor]
+        && (model.cycle >= model.echoStart[Sensor]) && (model.cycle < model.echoEnd[Sensor]);
+}
+
+/*
+ * The flag is set, the latency runs from the first time when it
+ * is set again before it is served
+ */
+static void FlagSet(ModelFlag_t *Flag, int Sensor, unsigned short Count)
+{
+    if(Flag->pending)
+        return;
+    Flag->set = model.cycle;
+    Flag->pending = 1;
+    Flag->sensor = (unsigned char)Sensor;
+    Flag->count = Count;
+}
+
+/*
+ * A flag the model set has been cleared, keep its latency when
+ * the ISR did it
+ */
+static void FlagServed(ModelFlag_t *Flag, int Bit, int Kind)
+{
+    ModelRecord_t *rec;
+
+    if(!Flag->pending || Bit)
+        return;
+    Flag->pending = 0;
+    if(!model.inIsr || (model.records >= MODEL_RECORD_MAX))
+        return;
+    rec = &model.record[model.records++];
+    rec->set = Flag->set;
+    rec->entry = (model.isrEntry > Flag->set) ? (unsigned long)(model.isrEntry - Flag->set) : 0;
+    rec->served = (unsigned long)(model.cycle - Flag->set);
+    rec->sensor = Flag->sensor;
+    rec->kind = (unsigned char)Kind;
+    rec->count = Flag->count;
+}
+
+/*
+ * Catch up with what the code wrote since the last step
+ */
+static void Sync(void)
+{
+    int trig;
+    int sensor;
+
+    trig = TRIG_PIN;
+    if(trig && !model.trig)
+    {
+        model.triggers++;
+        for(sensor = 0; sensor < GROUP_SIZE; sensor++)
+            Fire(TRIG_ADR * GROUP_SIZE + sensor);
+    }
+    model.trig = trig;
+
+    if(TXREG1 != 0xFFFF)
+    {
+        model.txreg = (unsigned char)TXREG1;
+        model.txregFull = 1;
+        PIR1bits.TX1IF = 0;
+        TXREG1 = 0xFFFF;
+    }
+
+    FlagServed(&model.gif, PIR3bits.TMR3GIF, MODEL_GATE);
+    FlagServed(&model.ccp[0], PIR1bits.CCP1IF, MODEL_CCP);
+    FlagServed(&model.ccp[1], PIR2bits.CCP2IF, MODEL_CCP);
+    FlagServed(&model.ccp[2], PIR4bits.CCP3IF, MODEL_CCP);
+    FlagServed(&model.ccp[3], PIR4bits.CCP4IF, MODEL_CCP);
+    FlagServed(&model.ccp[4], PIR4bits.CCP5IF, MODEL_CCP);
+    FlagServed(&model.tmr2, PIR1bits.TMR2IF, MODEL_TRIG);
+}
+
+static void CcpCapture(int Ccp)
+{
+    static volatile unsigned char *const con[5] = { &CCP1CON, &CCP2CON, &CCP3CON, &CCP4CON, &CCP5CON };
+    static volatile unsigned short *const ccpr[5] = { &CCPR1, &CCPR2, &CCPR3, &CCPR4, &CCPR5 };
+    int in;
+    int mode;
+
+    in = CCP_MODE && Echo(MUX_SEL * 5 + Ccp);
+    if(in == model.ccpIn[Ccp])
+        return;
+    model.ccpIn[Ccp] = in;
+    mode = *con[Ccp] & 0x0F;
+    if(!((mode == CCP_RISE) && in) && !((mode == CCP_FALL) && !in))
+        return;
+    *ccpr[Ccp] = TMR3;
+    switch(Ccp)
+    {
+    case 0: PIR1bits.CCP1IF = 1; break;
+    case 1: PIR2bits.CCP2IF = 1; break;
+    case 2: PIR4bits.CCP3IF = 1; break;
+    case 3: PIR4bits.CCP4IF = 1; break;
+    default: PIR4bits.CCP5IF = 1; break;
+    }
+    if(mode == CCP_FALL)
+        FlagSet(&model.ccp[Ccp], MUX_SEL * 5 + Ccp, TMR3);
+}
+
+static unsigned long BitCycles(void)
+{
+    unsigned long brg;
+
+    brg = BAUDCON1bits.BRG16 ? ((unsigned long)SPBRGH1 << 8 | SPBRG1) : SPBRG1;
+    if(BAUDCON1bits.BRG16 && TXSTA1bits.BRGH)
+        return brg + 1;                 /* FOSC/4 per count */
+    if(BAUDCON1bits.BRG16 || TXSTA1bits.BRGH)
+        return 4 * (brg + 1);           /* FOSC/16 */
+    return 16 * (brg + 1);              /* FOSC/64 */
+}
+
+/*
+ * One instruction cycle of the peripherals
+ */
+static void Tick(void)
+{
+    int count3;
+    int gate;
+    int ccp;
+
+    model.cycle++;
+
+    if(T0CONbits.TMR0ON)
+    {
+        if(++TMR0_sfr.w == 0)
+            INTCONbits.TMR0IF = 1;
+    }
+
+    if(T1CONbits.TMR1ON && (++model.pre1 >= (1u << T1CONbits.T1CKPS)))
+    {
+        model.pre1 = 0;
+        if(++TMR1 == 0)
+            PIR1bits.TMR1IF = 1;
+    }
+
+    if(T2CONbits.TMR2ON && (++model.pre2 >= (T2CONbits.T2CKPS ? (T2CONbits.T2CKPS == 1 ? 4u : 16u) : 1u)))
+    {
+        model.pre2 = 0;
+        if(TMR2 == PR2)
+        {
+            TMR2 = 0;
+            PIR1bits.TMR2IF = 1;
+            FlagSet(&model.tmr2, TRIG_ADR, 0);
+        }
+        else
+            TMR2++;
+    }
+
+    /* TIMER3 and its gate */
+    gate = CCP_MODE ? 0 : Echo(MUX_SEL);
+    if(!T3GCONbits.T3GPOL)
+        gate = !gate;
+    T3GCONbits.T3GVAL = gate;
+    count3 = T3CONbits.TMR3ON;
+    if(T3GCONbits.TMR3GE && T3GCONbits.T3GSPM)
+    {
+        if(!T3GCONbits.T3GGO_nDONE)
+            model.spm = SPM_IDLE;
+        else if(model.spm == SPM_IDLE)
+            model.spm = gate ? SPM_ACTIVE : SPM_WAIT;
+        else if((model.spm == SPM_ACTIVE) && !gate)
+            model.spm = SPM_WAIT;
+        else if((model.spm == SPM_WAIT) && gate)
+            model.spm = SPM_COUNT;
+        else if((model.spm == SPM_COUNT) && !gate)
+        {
+            model.spm = SPM_IDLE;
+            T3GCONbits.T3GGO_nDONE = 0;
+            PIR3bits.TMR3GIF = 1;
+            FlagSet(&model.gif, MUX_SEL, TMR3);
+        }
+        count3 = count3 && (model.spm == SPM_COUNT);
+    }
+    else if(T3GCONbits.TMR3GE)
+    {
+        count3 = count3 && gate;
+    }
+    model.gate = gate;
+    if(count3 && (++model.pre3 >= (1u << T3CONbits.T3CKPS)))
+    {
+        model.pre3 = 0;
+        if(++TMR3 == 0)
+            PIR2bits.TMR3IF = 1;
+    }
+
+    for(ccp = 0; ccp < 5; ccp++)
+        CcpCapture(ccp);
+
+    if(T5CONbits.TMR5ON && (++model.pre5 >= (1u << T5CONbits.T5CKPS)))
+    {
+        model.pre5 = 0;
+        if(++TMR5 == 0)
+            PIR5bits.TMR5IF = 1;
+    }
+
+    /* EUSART1 transmit, TXREG1 then the shift register */
+    if(RCSTA1bits.SPEN && TXSTA1bits.TXEN)
+    {
+        if(model.tsrBusy && (model.cycle >= model.tsrDone))
+            model.tsrBusy = 0;
+        if(!model.tsrBusy && model.txregFull)
+        {
+            model.tsrBusy = 1;
+            model.tsrDone = model.cycle + 10 * BitCycles();
+            model.txregFull = 0;
+            if(model.streamSize < MODEL_STREAM_MAX)
+                model.stream[model.streamSize++] = model.txreg;
+        }
+        PIR1bits.TX1IF = !model.txregFull;
+        TXSTA1bits.TRMT = !model.tsrBusy;
+    }
+}
+
+static int Pending(void)
+{
+    if(INTCONbits.TMR0IE && INTCONbits.TMR0IF)
+        return 1;
+    if(!INTCONbits.PEIE)
+        return 0;
+    return (PIE1 & PIR1) || (PIE2 & PIR2) || (PIE3 & PIR3) || (PIE4 & PIR4) || (PIE5 & PIR5);
+}
+
+/*
+ * Take the interrupt, GIE is cleared on entry and set again by
+ * RETFIE
+ */
+static void Interrupt(void)
+{
+    unsigned long long start;
+    int n;
+
+    start = model.cycle;
+    INTCONbits.GIE = 0;
+    model.inIsr = 1;
+    for(n = 0; n < MODEL_ENTRY_CYCLES; n++)
+        Tick();
+    model.isrEntry = model.cycle;
+    model.isrRuns++;
+    InterruptHandlerHigh();
+    Sync();
+    for(n = 0; n < MODEL_RETFIE_CYCLES; n++)
+        Tick();
+    model.inIsr = 0;
+    INTCONbits.GIE = 1;
+    model.isrCycles += (unsigned long)(model.cycle - start);
+    if(model.cycle - start > model.isrMax)
+        model.isrMax = (unsigned long)(model.cycle - start);
+}
+
+void Model_Step(unsigned Cycles)
+{
+    Sync();
+    while(Cycles--)
+        Tick();
+    if(!model.inIsr && INTCONbits.GIE && Pending())
+        Interrupt();
+    if(model.cycle >= model.stopAt)
+        longjmp(model.stop, 1);
+}
+
+/*
+ * Called by the compiler at each basic block of main.c
+ */
+void __sanitizer_cov_trace_pc(void)
+{
+    Model_Step(model.bbCycles);
+}
+
+/*
+ * Run Main for Cycles, returns 1 when it returned by itself
+ */
+int Model_Run(void (*Main)(void), unsigned long long Cycles)
+{
+    model.stopAt = model.cycle + Cycles;
+    if(setjmp(model.stop) == 0)
+    {
+        Main();
+        model.stopAt = ~0ULL;
+        return 1;
+    }
+    model.stopAt = ~0ULL;
+    model.inIsr = 0;
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Host model of the PIC18F23K22 peripherals main.c uses
+ *
+ * main.c is built with -fsanitize-coverage=trace-pc, the compiler
+ * then calls __sanitizer_cov_trace_pc at each basic block. The
+ * model charges MODEL_BB_CYCLES instruction cycles for each one,
+ * runs the peripherals for that time and takes the interrupt
+ * when one is due, so main and InterruptHandlerHigh run on the
+ * model clock as they would on the part.
+ *
+ * The cycle counts are rough. A basic block of main.c on the host
+ * is about one C statement, on the part it can be one instruction
+ * or a MulHigh. The latencies show where the time goes and how a
+ * change moves it, the ISR_STATS counts on the part stay the
+ * reference.
+ *
+ * Modelled, at FCYC:
+ *   TIMER0     16-bit, no prescaler, TMR0IF
+ *   TIMER1     prescaler, TMR1IF
+ *   TIMER2     prescaler, PR2 match, TMR2IF
+ *   TIMER3     prescaler, gate on the multiplexer output with
+ *              T3GPOL, single pulse mode with T3GSPM and
+ *              T3GGO_nDONE, T3GVAL, TMR3GIF, TMR3IF
+ *   TIMER5     prescaler, TMR5IF
+ *   CCP1-5     capture of TIMER3 on the rising or falling edge
+ *   EUSART1    TXREG1 and the shift register, TX1IF, TRMT
+ *   sensors    the TRIG rising edge fires the sensor or group on
+ *              TRIG_ADR, its echo comes from the pulse trace
+ *
+ * The legacy interrupt model is used, IPEN is 0 in main.c.
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <setjmp.h>
+
+#define MODEL_FCYC          4000000UL   /* main.c FCYC */
+#define MODEL_BB_CYCLES     3           /* cycles for each basic block of main.c */
+#define MODEL_ENTRY_CYCLES  3           /* interrupt flag to the first ISR instruction */
+#define MODEL_RETFIE_CYCLES 2
+#define MODEL_SENSORS       16          /* main.c SENSOR_SAMPLE_SIZE */
+#define MODEL_TRACE_MAX     64          /* pulses in the trace of one sensor */
+#define MODEL_RECORD_MAX    100000
+#define MODEL_STREAM_MAX    200000
+
+#define MODEL_US(us)        ((unsigned long long)(us) * (MODEL_FCYC / 1000000UL))
+
+/* One echo of a sensor from the trace, width 0 for no echo */
+typedef struct {
+    unsigned long delayUs;              /* TRIG rising edge to the echo */
+    unsigned long widthUs;
+} ModelPulse_t;
+
+/*
+ * Interrupt flag the latency is kept for
+ *
+ * Set by the model when the event happens, served when the ISR
+ * clears the flag. entry is the start of the ISR run that cleared
+ * it, a flag set during a run and cleared in it has no wait.
+ */
+typedef struct {
+    unsigned long long set;             /* cycle the flag was set */
+    unsigned char pending;
+    unsigned char sensor;               /* sensor of a capture */
+    unsigned short count;               /* TIMER3 count or capture */
+} ModelFlag_t;
+
+typedef struct {
+    unsigned long long set;             /* cycle of the event */
+    unsigned long entry;                /* cycles to the ISR start */
+    unsigned long served;               /* cycles to the flag cleared */
+    unsigned char sensor;
+    unsigned char kind;                 /* MODEL_GATE, MODEL_CCP or MODEL_TRIG */
+    unsigned short count;
+} ModelRecord_t;
+
+#define MODEL_GATE  0
+#define MODEL_CCP   1
+#define MODEL_TRIG  2
+
+typedef struct {
+    unsigned long long cycle;           /* FCYC cycles since reset */
+    unsigned long long stopAt;          /* end of the run */
+    unsigned bbCycles;
+    jmp_buf stop;
+
+    /* interrupts */
+    int inIsr;
+    unsigned long long isrEntry;        /* start of the ISR run */
+    unsigned long isrRuns;
+    unsigned long isrCycles;            /* cycles in the ISR, entry and exit included */
+    unsigned long isrMax;               /* longest ISR run */
+
+    /* timers */
+    unsigned pre1, pre2, pre3, pre5;    /* prescaler counts */
+    int spm;                            /* single pulse state, see model.c */
+    int gate;                           /* TIMER3 gate input, after T3GPOL */
+
+    /* sensors */
+    ModelPulse_t trace[MODEL_SENSORS][MODEL_TRACE_MAX];
+    int traceSize[MODEL_SENSORS];
+    int traceNext[MODEL_SENSORS];
+    unsigned long long echoStart[MODEL_SENSORS];
+    unsigned long long echoEnd[MODEL_SENSORS];  /* 0 for no echo */
+    int trig;                           /* TRIG as last seen */
+    unsigned long triggers;
+    int ccpIn[5];                       /* CCP inputs as last seen */
+
+    /* EUSART1 */
+    int txregFull;
+    unsigned char txreg;
+    int tsrBusy;
+    unsigned long long tsrDone;
+    unsigned char stream[MODEL_STREAM_MAX];
+    unsigned long streamSize;
+
+    /* latency */
+    ModelFlag_t gif;                    /* TMR3GIF */
+    ModelFlag_t ccp[5];                 /* CCP1IF-CCP5IF on a falling edge */
+    ModelFlag_t tmr2;                   /* TMR2IF, end of the trigger pulse */
+    ModelRecord_t record[MODEL_RECORD_MAX];
+    unsigned long records;
+} Model_t;
+
+extern Model_t model;
+
+void Model_Reset(void);
+int  Model_LoadTrace(const char *Path);
+void Model_Step(unsigned Cycles);
+int  Model_Run(void (*Main)(void), unsigned long long Cycles);
+
+/* main.c, as built for the host with -Dint=short */
+typedef struct {
+    unsigned short seq;
+    unsigned long roundTime;
+    unsigned short sensorData[MODEL_SENSORS];
+} ModelFrame_t;
+
+extern volatile ModelFrame_t sensorFrame[2];
+extern volatile unsigned char sensorPublished;
+extern volatile unsigned short sensorTimeouts[MODEL_SENSORS];
+extern volatile unsigned char captureOn;
+void app_main(void);
+void InterruptHandlerHigh(void);
+
+#endif
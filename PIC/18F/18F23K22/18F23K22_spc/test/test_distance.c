@@ -0,0 +1,54 @@
+/*
+ * Exhaustive check of SensorDistance
+ *
+ * main.c is built into this file, the Makefile builds it once for
+ * each SENSOR_TICKS_PER_UNIT from 2 to 257 and once with
+ * SENSOR_UNITS_MM. Every TIMER3 count is converted and compared
+ * with a divide. The 8-bit scale must match exactly, millimetres
+ * may be one off from the rounding of SENSOR_MM_SCALE.
+ */
+#include "../18F23K22_spc.X/main.c"
+#undef main
+#undef int
+
+#include <stdio.h>
+
+int main(void)
+{
+    unsigned long ticks;
+    unsigned long want;
+    unsigned long got;
+    unsigned long bad = 0;
+
+    for(ticks = 0; ticks <= 0xFFFF; ticks++)
+    {
+        got = SensorDistance((unsigned short)ticks);
+#if SENSOR_UNITS_MM
+        want = ticks * (1000UL << SENSOR_T3CKPS) / ((FCYC/1000000L) * SENSOR_NS_PER_MM);
+        if((ticks >= SENSOR_RANGE_TICKS) || (want > SENSOR_RANGE_MM))
+            want = SENSOR_RANGE_MM;
+        if((got > want + 1) || (got + 1 < want))
+#else
+        want = ticks / SENSOR_TICKS_PER_UNIT;
+        if(want > SENSOR_MAX_UNITS)
+            want = SENSOR_MAX_UNITS;
+        if(got != want)
+#endif
+        {
+            if(bad++ < 10)
+                printf("  %lu counts: %lu, want %lu\n", ticks, got, want);
+        }
+    }
+#if SENSOR_UNITS_MM
+    printf("distance mm, TIMER3 1:%d: ", 1 << SENSOR_T3CKPS);
+#else
+    printf("distance SENSOR_TICKS_PER_UNIT %d: ", SENSOR_TICKS_PER_UNIT);
+#endif
+    if(bad)
+    {
+        printf("%lu of 65536 counts wrong\n", bad);
+        return 1;
+    }
+    printf("65536 counts ok\n");
+    return 0;
+}
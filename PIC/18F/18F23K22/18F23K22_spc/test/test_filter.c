@@ -0,0 +1,109 @@
+/*
+ * Check of FilterFrame against a plain model of the filters
+ *
+ * main.c is built into this file, the Makefile builds it with
+ * several SENSOR_MEDIAN and SENSOR_IIR_SHIFT settings. Random
+ * rounds, with odd readings and missing echoes mixed in, go
+ * through FilterFrame and through the model below, which sorts
+ * the history and keeps the IIR state in a long. Every output
+ * must match.
+ */
+#include "../18F23K22_spc.X/main.c"
+#undef main
+#undef int
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROUNDS 20000
+
+#if SENSOR_MEDIAN
+static unsigned long modelHistory[SENSOR_MEDIAN][SENSOR_SAMPLE_SIZE];
+#endif
+#if SENSOR_IIR_SHIFT
+static long modelIir[SENSOR_SAMPLE_SIZE];
+#endif
+static int modelRound = 0;
+
+static unsigned long ModelFilter(int sensor, unsigned long value)
+{
+#if SENSOR_MEDIAN
+    unsigned long v[SENSOR_MEDIAN];
+    unsigned long t;
+    int i, j;
+
+    for(i = 0; i < SENSOR_MEDIAN; i++)
+        modelHistory[i][sensor] = (modelRound == 0) ? value : modelHistory[i][sensor];
+    modelHistory[modelRound % SENSOR_MEDIAN][sensor] = value;
+    for(i = 0; i < SENSOR_MEDIAN; i++)
+        v[i] = modelHistory[i][sensor];
+    for(i = 0; i < SENSOR_MEDIAN; i++)
+        for(j = i + 1; j < SENSOR_MEDIAN; j++)
+            if(v[j] < v[i]) { t = v[i]; v[i] = v[j]; v[j] = t; }
+    value = v[SENSOR_MEDIAN/2];
+#endif
+#if SENSOR_IIR_SHIFT
+    if(value != SENSOR_NO_ECHO)
+    {
+        if((modelRound == 0) || (modelIir[sensor] < 0))
+            modelIir[sensor] = (long)value << SENSOR_IIR_SHIFT;
+        else
+            modelIir[sensor] += (long)value - (modelIir[sensor] >> SENSOR_IIR_SHIFT);
+        value = (modelIir[sensor] + (1 << (SENSOR_IIR_SHIFT-1))) >> SENSOR_IIR_SHIFT;
+    }
+    else if(modelRound == 0)
+    {
+        modelIir[sensor] = -1;  /* no echo yet */
+    }
+#endif
+    return value;
+}
+
+static unsigned short Reading(int sensor)
+{
+    int r = rand() % 100;
+
+    if(r < 5)
+        return SENSOR_NO_ECHO;
+    if(r < 10)
+        return rand() % (SENSOR_MAX_VALUE + 1);     /* odd reading */
+    if(r < 12)
+        return SENSOR_MAX_VALUE;
+    /* a slow walk for each sensor */
+    return (unsigned short)((sensor * 40 + (modelRound / 50) % 120 + rand() % 3) % (SENSOR_MAX_VALUE + 1));
+}
+
+int main(void)
+{
+    SensorFrame_t frame;
+    unsigned short in[SENSOR_SAMPLE_SIZE];
+    unsigned long want;
+    unsigned long bad = 0;
+    int sensor;
+
+    srand(1);
+    for(modelRound = 0; modelRound < ROUNDS; modelRound++)
+    {
+        for(sensor = 0; sensor < SENSOR_SAMPLE_SIZE; sensor++)
+            frame.sensorData[sensor] = in[sensor] = Reading(sensor);
+        FilterFrame(&frame);
+        for(sensor = 0; sensor < SENSOR_SAMPLE_SIZE; sensor++)
+        {
+            want = ModelFilter(sensor, in[sensor]);
+            if(frame.sensorData[sensor] != want)
+            {
+                if(bad++ < 10)
+                    printf("  round %d sensor %d: in %u out %u, want %lu\n",
+                        modelRound, sensor, in[sensor], frame.sensorData[sensor], want);
+            }
+        }
+    }
+    printf("filter median %d, IIR shift %d: ", SENSOR_MEDIAN, SENSOR_IIR_SHIFT);
+    if(bad)
+    {
+        printf("%lu of %d outputs wrong\n", bad, ROUNDS * SENSOR_SAMPLE_SIZE);
+        return 1;
+    }
+    printf("%d rounds ok\n", ROUNDS);
+    return 0;
+}
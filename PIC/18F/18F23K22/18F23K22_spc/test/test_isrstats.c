@@ -0,0 +1,71 @@
+/*
+ * Check of IsrStatsUpdate and GetIsrStats
+ *
+ * main.c is built into this file with ISR_STATS set. Runs with
+ * known TIMER0 entry and exit counts go in, including ones that
+ * wrap TIMER0 and a trigger pulse end the ISR was already running
+ * for, and the stats must come out as worked out by hand.
+ */
+#define ISR_STATS 1
+#include "../18F23K22_spc.X/main.c"
+#undef main
+#undef int
+
+#include <stdio.h>
+
+static int bad = 0;
+
+static void Expect(const char *What, unsigned long Got, unsigned long Want)
+{
+    if(Got != Want)
+    {
+        printf("  %s: %lu, want %lu\n", What, Got, Want);
+        bad = 1;
+    }
+}
+
+int main(void)
+{
+    IsrStats_t copy;
+
+    IsrStatsReset();
+    Expect("count after reset", isrStats.count, 0);
+    Expect("timeMin after reset", isrStats.timeMin, 0xFFFF);
+
+    /* plain run, not the end of a trigger pulse */
+    IsrStatsUpdate(1000, 1040, 0);
+    /* TIMER0 wraps during the run */
+    IsrStatsUpdate(0xFFF0, 0x0010, 0);
+    /* trigger pulse end 12 cycles late */
+    isrTrigDue = 2000;
+    IsrStatsUpdate(2012, 2100, 1);
+    /* trigger pulse end with TIMER0 wrapping in between */
+    isrTrigDue = 0xFFFE;
+    IsrStatsUpdate(0x0005, 0x0030, 1);
+    /* the ISR was entered for something else just before the match */
+    isrTrigDue = 3000;
+    IsrStatsUpdate(2990, 3050, 1);
+
+    Expect("count", isrStats.count, 5);
+    Expect("timeMin", isrStats.timeMin, 32);
+    Expect("timeMax", isrStats.timeMax, 88);
+    Expect("timeSum", isrStats.timeSum, 40 + 32 + 88 + 43 + 60);
+    Expect("latencyCount", isrStats.latencyCount, 3);
+    Expect("latencyMin", isrStats.latencyMin, 0);
+    Expect("latencyMax", isrStats.latencyMax, 12);
+    Expect("latencySum", isrStats.latencySum, 12 + 7 + 0);
+
+    GetIsrStats(&copy, 1);
+    Expect("copy count", copy.count, 5);
+    Expect("copy latencySum", copy.latencySum, 19);
+    Expect("count after GetIsrStats reset", isrStats.count, 0);
+    Expect("latencyMax after GetIsrStats reset", isrStats.latencyMax, 0);
+    Expect("GIE after GetIsrStats", INTCONbits.GIE, 0);
+
+    INTCONbits.GIE = 1;
+    GetIsrStats(&copy, 0);
+    Expect("GIE kept by GetIsrStats", INTCONbits.GIE, 1);
+
+    printf("ISR stats: %s\n", bad ? "FAIL" : "ok");
+    return bad;
+}
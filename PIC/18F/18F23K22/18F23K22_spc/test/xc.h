@@ -0,0 +1,241 @@
+/*
+ * Host stand-in for the XC8 device header of the PIC18F23K22
+ *
+ * Only the registers and bits main.c uses are here. Each register
+ * is a plain variable, the bits alias it through a union laid out
+ * as on the part, low bit first, so a write to T3GCON shows in
+ * T3GCONbits. 16-bit timers and capture registers share their
+ * storage with the L and H bytes.
+ *
+ * TXREG1 is wider than the real register and holds 0xFFFF until
+ * a byte is written, so a model can see the write.
+ *
+ * The registers are defined in the file that includes this one
+ * with XC_SFR_DEFINE set, see sfr.c.
+ */
+#ifndef XC_H
+#define XC_H
+
+#ifdef XC_SFR_DEFINE
+#define XC_SFR volatile
+#else
+#define XC_SFR extern volatile
+#endif
+
+#define interrupt
+#define low_priority
+
+#define NOP()       ((void)0)
+#define CLRWDT()    ((void)0)
+
+/* register with named bits, low bit first */
+#define XC_SFR8(name, ...) \
+    typedef union { unsigned char reg; struct { unsigned __VA_ARGS__; } bits; } name##_t; \
+    XC_SFR name##_t name##_sfr
+
+typedef union { unsigned short w; struct { unsigned char l, h; } b; } XC_SFR16_t;
+
+XC_SFR8(INTCON, RBIF:1, INT0IF:1, TMR0IF:1, RBIE:1, INT0IE:1, TMR0IE:1, PEIE:1, GIE:1);
+#define INTCON      INTCON_sfr.reg
+#define INTCONbits  INTCON_sfr.bits
+XC_SFR unsigned char INTCON3;
+
+XC_SFR8(PIR1, TMR1IF:1, TMR2IF:1, CCP1IF:1, SSP1IF:1, TX1IF:1, RC1IF:1, ADIF:1, :1);
+XC_SFR8(PIE1, TMR1IE:1, TMR2IE:1, CCP1IE:1, SSP1IE:1, TX1IE:1, RC1IE:1, ADIE:1, :1);
+XC_SFR8(IPR1, TMR1IP:1, TMR2IP:1, CCP1IP:1, SSP1IP:1, TX1IP:1, RC1IP:1, ADIP:1, :1);
+XC_SFR8(PIR2, CCP2IF:1, TMR3IF:1, HLVDIF:1, BCL1IF:1, EEIF:1, C2IF:1, C1IF:1, OSCFIF:1);
+XC_SFR8(PIE2, CCP2IE:1, TMR3IE:1, HLVDIE:1, BCL1IE:1, EEIE:1, C2IE:1, C1IE:1, OSCFIE:1);
+XC_SFR8(IPR2, CCP2IP:1, TMR3IP:1, HLVDIP:1, BCL1IP:1, EEIP:1, C2IP:1, C1IP:1, OSCFIP:1);
+XC_SFR8(PIR3, TMR1GIF:1, TMR3GIF:1, TMR5GIF:1, CTMUIF:1, TX2IF:1, RC2IF:1, BCL2IF:1, SSP2IF:1);
+XC_SFR8(PIE3, TMR1GIE:1, TMR3GIE:1, TMR5GIE:1, CTMUIE:1, TX2IE:1, RC2IE:1, BCL2IE:1, SSP2IE:1);
+XC_SFR8(IPR3, TMR1GIP:1, TMR3GIP:1, TMR5GIP:1, CTMUIP:1, TX2IP:1, RC2IP:1, BCL2IP:1, SSP2IP:1);
+XC_SFR8(PIR4, CCP3IF:1, CCP4IF:1, CCP5IF:1, :5);
+XC_SFR8(PIE4, CCP3IE:1, CCP4IE:1, CCP5IE:1, :5);
+XC_SFR8(IPR4, CCP3IP:1, CCP4IP:1, CCP5IP:1, :5);
+XC_SFR8(PIR5, TMR4IF:1, TMR5IF:1, TMR6IF:1, :5);
+XC_SFR8(PIE5, TMR4IE:1, TMR5IE:1, TMR6IE:1, :5);
+XC_SFR8(IPR5, TMR4IP:1, TMR5IP:1, TMR6IP:1, :5);
+#define PIR1        PIR1_sfr.reg
+#define PIR1bits    PIR1_sfr.bits
+#define PIE1        PIE1_sfr.reg
+#define PIE1bits    PIE1_sfr.bits
+#define IPR1        IPR1_sfr.reg
+#define IPR1bits    IPR1_sfr.bits
+#define PIR2        PIR2_sfr.reg
+#define PIR2bits    PIR2_sfr.bits
+#define PIE2        PIE2_sfr.reg
+#define PIE2bits    PIE2_sfr.bits
+#define IPR2        IPR2_sfr.reg
+#define IPR2bits    IPR2_sfr.bits
+#define PIR3        PIR3_sfr.reg
+#define PIR3bits    PIR3_sfr.bits
+#define PIE3        PIE3_sfr.reg
+#define PIE3bits    PIE3_sfr.bits
+#define IPR3        IPR3_sfr.reg
+#define IPR3bits    IPR3_sfr.bits
+#define PIR4        PIR4_sfr.reg
+#define PIR4bits    PIR4_sfr.bits
+#define PIE4        PIE4_sfr.reg
+#define PIE4bits    PIE4_sfr.bits
+#define IPR4        IPR4_sfr.reg
+#define IPR4bits    IPR4_sfr.bits
+#define PIR5        PIR5_sfr.reg
+#define PIR5bits    PIR5_sfr.bits
+#define PIE5        PIE5_sfr.reg
+#define PIE5bits    PIE5_sfr.bits
+#define IPR5        IPR5_sfr.reg
+#define IPR5bits    IPR5_sfr.bits
+
+XC_SFR8(RCON, nBOR:1, nPOR:1, nPD:1, nTO:1, nRI:1, :1, SBOREN:1, IPEN:1);
+#define RCON        RCON_sfr.reg
+#define RCONbits    RCON_sfr.bits
+
+/* Timers */
+XC_SFR8(T0CON, T0PS:3, PSA:1, T0SE:1, T0CS:1, T08BIT:1, TMR0ON:1);
+#define T0CON       T0CON_sfr.reg
+#define T0CONbits   T0CON_sfr.bits
+#define _T0CON_T0PS_POSITION        0
+#define _T0CON_PSA_POSITION         3
+#define _T0CON_T0SE_POSITION        4
+#define _T0CON_T0CS_POSITION        5
+#define _T0CON_T08BIT_POSITION      6
+#define _T0CON_TMR0ON_POSITION      7
+
+XC_SFR8(T1CON, TMR1ON:1, T1RD16:1, nT1SYNC:1, T1SOSCEN:1, T1CKPS:2, TMR1CS:2);
+XC_SFR8(T3CON, TMR3ON:1, T3RD16:1, nT3SYNC:1, T3SOSCEN:1, T3CKPS:2, TMR3CS:2);
+XC_SFR8(T5CON, TMR5ON:1, T5RD16:1, nT5SYNC:1, T5SOSCEN:1, T5CKPS:2, TMR5CS:2);
+#define T1CON       T1CON_sfr.reg
+#define T1CONbits   T1CON_sfr.bits
+#define T3CON       T3CON_sfr.reg
+#define T3CONbits   T3CON_sfr.bits
+#define T5CON       T5CON_sfr.reg
+#define T5CONbits   T5CON_sfr.bits
+#define _T1CON_TMR1ON_POSITION      0
+#define _T1CON_T1RD16_POSITION      1
+#define _T1CON_nT1SYNC_POSITION     2
+#define _T1CON_T1SOSCEN_POSITION    3
+#define _T1CON_T1CKPS_POSITION      4
+#define _T1CON_TMR1CS_POSITION      6
+#define _T3CON_TMR3ON_POSITION      0
+#define _T3CON_T3RD16_POSITION      1
+#define _T3CON_nT3SYNC_POSITION     2
+#define _T3CON_T3SOSCEN_POSITION    3
+#define _T3CON_T3CKPS_POSITION      4
+#define _T3CON_TMR3CS_POSITION      6
+#define _T5CON_TMR5ON_POSITION      0
+#define _T5CON_T5RD16_POSITION      1
+#define _T5CON_nT5SYNC_POSITION     2
+#define _T5CON_T5SOSCEN_POSITION    3
+#define _T5CON_T5CKPS_POSITION      4
+#define _T5CON_TMR5CS_POSITION      6
+
+XC_SFR8(T3GCON, T3GSS:2, T3GVAL:1, T3GGO_nDONE:1, T3GSPM:1, T3GTM:1, T3GPOL:1, TMR3GE:1);
+#define T3GCON      T3GCON_sfr.reg
+#define T3GCONbits  T3GCON_sfr.bits
+#define _T3GCON_T3GSS_POSITION      0
+#define _T3GCON_T3GVAL_POSITION     2
+#define _T3GCON_T3GGO_nDONE_POSITION 3
+#define _T3GCON_T3GSPM_POSITION     4
+#define _T3GCON_T3GTM_POSITION      5
+#define _T3GCON_T3GPOL_POSITION     6
+#define _T3GCON_TMR3GE_POSITION     7
+
+XC_SFR8(T2CON, T2CKPS:2, TMR2ON:1, T2OUTPS:4, :1);
+#define T2CON       T2CON_sfr.reg
+#define T2CONbits   T2CON_sfr.bits
+XC_SFR unsigned char TMR2;
+XC_SFR unsigned char PR2;
+
+XC_SFR XC_SFR16_t TMR0_sfr;
+XC_SFR XC_SFR16_t TMR1_sfr;
+XC_SFR XC_SFR16_t TMR3_sfr;
+XC_SFR XC_SFR16_t TMR5_sfr;
+#define TMR0L       TMR0_sfr.b.l
+#define TMR0H       TMR0_sfr.b.h
+#define TMR1        TMR1_sfr.w
+#define TMR1L       TMR1_sfr.b.l
+#define TMR1H       TMR1_sfr.b.h
+#define TMR3        TMR3_sfr.w
+#define TMR3L       TMR3_sfr.b.l
+#define TMR3H       TMR3_sfr.b.h
+#define TMR5        TMR5_sfr.w
+#define TMR5L       TMR5_sfr.b.l
+#define TMR5H       TMR5_sfr.b.h
+
+/* Capture */
+XC_SFR unsigned char CCP1CON;
+XC_SFR unsigned char CCP2CON;
+XC_SFR unsigned char CCP3CON;
+XC_SFR unsigned char CCP4CON;
+XC_SFR unsigned char CCP5CON;
+XC_SFR unsigned char CCPTMRS0;
+XC_SFR unsigned char CCPTMRS1;
+XC_SFR XC_SFR16_t CCPR1_sfr;
+XC_SFR XC_SFR16_t CCPR2_sfr;
+XC_SFR XC_SFR16_t CCPR3_sfr;
+XC_SFR XC_SFR16_t CCPR4_sfr;
+XC_SFR XC_SFR16_t CCPR5_sfr;
+#define CCPR1       CCPR1_sfr.w
+#define CCPR2       CCPR2_sfr.w
+#define CCPR3       CCPR3_sfr.w
+#define CCPR4       CCPR4_sfr.w
+#define CCPR5       CCPR5_sfr.w
+
+/* EUSART1 */
+XC_SFR8(TXSTA1, TX9D:1, TRMT:1, BRGH:1, SENDB:1, SYNC:1, TXEN:1, TX9:1, CSRC:1);
+XC_SFR8(RCSTA1, RX9D:1, OERR:1, FERR:1, ADDEN:1, CREN:1, SREN:1, RX9:1, SPEN:1);
+XC_SFR8(BAUDCON1, ABDEN:1, WUE:1, :1, BRG16:1, CKTXP:1, DTRXP:1, RCIDL:1, ABDOVF:1);
+#define TXSTA1      TXSTA1_sfr.reg
+#define TXSTA1bits  TXSTA1_sfr.bits
+#define RCSTA1      RCSTA1_sfr.reg
+#define RCSTA1bits  RCSTA1_sfr.bits
+#define BAUDCON1    BAUDCON1_sfr.reg
+#define BAUDCON1bits BAUDCON1_sfr.bits
+XC_SFR unsigned char SPBRG1;
+XC_SFR unsigned char SPBRGH1;
+XC_SFR unsigned short TXREG1;
+
+/* Oscillator and the peripherals main.c turns off */
+XC_SFR8(OSCCON, SCS:2, HFIOFS:1, OSTS:1, IRCF:3, IDLEN:1);
+XC_SFR8(OSCTUNE, TUN:6, PLLEN:1, INTSRC:1);
+XC_SFR8(CM1CON0, C1CH:2, C1R:1, C1SP:1, C1POL:1, C1OE:1, C1OUT:1, C1ON:1);
+XC_SFR8(CM2CON0, C2CH:2, C2R:1, C2SP:1, C2POL:1, C2OE:1, C2OUT:1, C2ON:1);
+XC_SFR8(VREFCON1, DACNSS:1, :1, DACPSS:2, :1, DACOE:1, DACLPS:1, DACEN:1);
+XC_SFR8(SLRCON, SLRA:1, SLRB:1, SLRC:1, :5);
+XC_SFR8(SRCON0, SRPR:1, SRPS:1, SRNQEN:1, SRQEN:1, SRCLK:3, SRLEN:1);
+XC_SFR8(SSP1CON1, SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1);
+XC_SFR8(SSP2CON1, SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1);
+#define OSCCONbits  OSCCON_sfr.bits
+#define OSCTUNEbits OSCTUNE_sfr.bits
+#define CM1CON0bits CM1CON0_sfr.bits
+#define CM2CON0bits CM2CON0_sfr.bits
+#define VREFCON1bits VREFCON1_sfr.bits
+#define SLRCONbits  SLRCON_sfr.bits
+#define SRCON0bits  SRCON0_sfr.bits
+#define SSP1CON1bits SSP1CON1_sfr.bits
+#define SSP2CON1bits SSP2CON1_sfr.bits
+
+/* Ports */
+XC_SFR unsigned char ANSELA;
+XC_SFR unsigned char ANSELB;
+XC_SFR unsigned char ANSELC;
+XC_SFR8(TRISA, TRISA0:1, TRISA1:1, TRISA2:1, TRISA3:1, TRISA4:1, TRISA5:1, TRISA6:1, TRISA7:1);
+XC_SFR8(TRISB, TRISB0:1, TRISB1:1, TRISB2:1, TRISB3:1, TRISB4:1, TRISB5:1, TRISB6:1, TRISB7:1);
+XC_SFR8(TRISC, TRISC0:1, TRISC1:1, TRISC2:1, TRISC3:1, TRISC4:1, TRISC5:1, TRISC6:1, TRISC7:1);
+XC_SFR8(LATA, LATA0:1, LATA1:1, LATA2:1, LATA3:1, LATA4:1, LATA5:1, LATA6:1, LATA7:1);
+XC_SFR8(LATB, LATB0:1, LATB1:1, LATB2:1, LATB3:1, LATB4:1, LATB5:1, LATB6:1, LATB7:1);
+XC_SFR8(LATC, LATC0:1, LATC1:1, LATC2:1, LATC3:1, LATC4:1, LATC5:1, LATC6:1, LATC7:1);
+#define TRISA       TRISA_sfr.reg
+#define TRISAbits   TRISA_sfr.bits
+#define TRISB       TRISB_sfr.reg
+#define TRISBbits   TRISB_sfr.bits
+#define TRISC       TRISC_sfr.reg
+#define TRISCbits   TRISC_sfr.bits
+#define LATA        LATA_sfr.reg
+#define LATAbits    LATA_sfr.bits
+#define LATB        LATB_sfr.reg
+#define LATBbits    LATB_sfr.bits
+#define LATC        LATC_sfr.reg
+#define LATCbits    LATC_sfr.bits
+
+#endif
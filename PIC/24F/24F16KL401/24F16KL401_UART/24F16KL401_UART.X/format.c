@@ -0,0 +1,333 @@
+/*  
+**     file: format.c
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  Number to text formatting for PIC24.
+**  
+** Notes:
+**  Each function stores text at the caller's pointer and returns
+**  the number of characters stored, nothing is terminated. This
+**  lets a whole record be rendered into one buffer by stepping
+**  a pointer along, then sent to a UART with a single write:
+**
+**      char Line[40];
+**      char *p = Line;
+**
+**      p += Fmt_String(p, "ADC ");
+**      p += Fmt_HexWord(p, Raw);
+**      p += Fmt_Dec16(p, Millivolts, 6, 0);
+**      p += Fmt_CrLf(p);
+**      U2_PutBuffer(Line, p - Line);
+**
+**  Decimal conversion does not use divide. Each digit is found
+**  with four compare and subtract steps against 8, 4, 2 and 1
+**  times its power of ten so every value takes the same time.
+**  The weight tables hold the largest step for each digit, the
+**  smaller steps are made by shifting it right. The four steps
+**  are written out in the loop over the digits, a second loop
+**  for them took half as long again. fmt_bench in ../test
+**  compares the cost with the old Generic_PutDec ladder.
+**  
+*/  
+#include "format.h"
+
+static const char HexChar[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+
+/*
+** Largest subtract step for each digit. The leading digit of a
+** 32-bit or 16-bit value is at most 4 or 6 so it is found with
+** three steps of its own, starting at 4.
+*/
+static const unsigned long DecWeightLong[5] = {
+    800000000UL, 80000000UL, 8000000UL, 800000UL, 80000UL
+};
+static const unsigned short DecWeightShort[3] = {
+    8000U, 800U, 80U
+};
+
+/* One compare and subtract step */
+#define FMT_STEP(Dec, Weight, Digit, Mask) \
+    if ((Dec) >= (Weight))                 \
+    {                                      \
+        (Dec) -= (Weight);                 \
+        (Digit) += (Mask);                 \
+    }
+
+/*
+** Declare private functions
+*/
+static unsigned short Fmt_DigitsShort( char *pDigit, unsigned short Dec );
+static unsigned char Fmt_Layout( char *pBuf, const char *pDigit, unsigned char Digits, unsigned char Width, unsigned char Flags );
+
+/*
+** Function: Fmt_Dec16
+**
+** Precondition: None.
+**
+** Overview: Convert a 16-bit value to decimal text.
+**
+** Input: Pointer to the output buffer, it must hold at least
+**        Width or FMT_DEC16_DIGITS characters, whichever is larger.
+**        Binary value.
+**        Field width, zero for no padding.
+**        Layout flags FMT_LEFT or FMT_ZERO.
+**
+** Output: Number of characters stored, the text is not terminated.
+**
+*/
+unsigned char
+Fmt_Dec16(
+    char *pBuf,
+    unsigned short Dec,
+    unsigned char Width,
+    unsigned char Flags
+    )
+{
+    char Digit[FMT_DEC16_DIGITS];
+
+    Digit[0] = '0';
+    FMT_STEP(Dec, 40000U, Digit[0], 4);
+    FMT_STEP(Dec, 20000U, Digit[0], 2);
+    FMT_STEP(Dec, 10000U, Digit[0], 1);
+    Dec = Fmt_DigitsShort(&Digit[1], Dec);
+    Digit[FMT_DEC16_DIGITS-1] = (char)Dec + '0';
+    return Fmt_Layout(pBuf, Digit, FMT_DEC16_DIGITS, Width, Flags);
+}
+
+/*
+** Function: Fmt_Dec32
+**
+** Precondition: None.
+**
+** Overview: Convert a 32-bit value to decimal text.
+**
+** Input: Pointer to the output buffer, it must hold at least
+**        Width or FMT_DEC32_DIGITS characters, whichever is larger.
+**        Binary value.
+**        Field width, zero for no padding.
+**        Layout flags FMT_LEFT or FMT_ZERO.
+**
+** Output: Number of characters stored, the text is not terminated.
+**
+*/
+unsigned char
+Fmt_Dec32(
+    char *pBuf,
+    unsigned long Dec,
+    unsigned char Width,
+    unsigned char Flags
+    )
+{
+    char Digit[FMT_DEC32_DIGITS];
+    char *pDigit;
+    unsigned long Weight;
+    unsigned char Index;
+    unsigned short Dec16;
+
+    /* The top six digits need 32-bit math */
+    Digit[0] = '0';
+    FMT_STEP(Dec, 4000000000UL, Digit[0], 4);
+    FMT_STEP(Dec, 2000000000UL, Digit[0], 2);
+    FMT_STEP(Dec, 1000000000UL, Digit[0], 1);
+    pDigit = &Digit[1];
+    for (Index = 0; Index < 5; Index++)
+    {
+        Weight = DecWeightLong[Index];
+        *pDigit = '0';
+        FMT_STEP(Dec, Weight, *pDigit, 8);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 4);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 2);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 1);
+        pDigit++;
+    }
+    /* What is left is less than 10000 */
+    Dec16 = Fmt_DigitsShort(&Digit[6], (unsigned short)Dec);
+    Digit[FMT_DEC32_DIGITS-1] = (char)Dec16 + '0';
+    return Fmt_Layout(pBuf, Digit, FMT_DEC32_DIGITS, Width, Flags);
+}
+
+/*
+** Function: Fmt_Hex
+**
+** Precondition: None.
+**
+** Overview: Convert a byte to hexadecimal text.
+**
+** Input: Pointer to the output buffer, it must hold
+**        FMT_HEX_DIGITS characters.
+**        Binary value.
+**
+** Output: Number of characters stored.
+**
+*/
+unsigned char
+Fmt_Hex(
+    char *pBuf,
+    unsigned char Hex
+    )
+{
+    pBuf[0] = HexChar[(Hex>>4) & 0x0F ];
+    pBuf[1] = HexChar[ Hex     & 0x0F ];
+    return FMT_HEX_DIGITS;
+}
+
+/*
+** Function: Fmt_HexWord
+**
+** Precondition: None.
+**
+** Overview: Convert a 16-bit value to hexadecimal text.
+**
+** Input: Pointer to the output buffer, it must hold
+**        FMT_HEXWORD_DIGITS characters.
+**        Binary value.
+**
+** Output: Number of characters stored.
+**
+*/
+unsigned char
+Fmt_HexWord(
+    char *pBuf,
+    unsigned short Hex
+    )
+{
+    Fmt_Hex(pBuf, (unsigned char)(Hex>>8));
+    Fmt_Hex(pBuf+FMT_HEX_DIGITS, (unsigned char)Hex);
+    return FMT_HEXWORD_DIGITS;
+}
+
+/*
+** Function: Fmt_String
+**
+** Precondition: None.
+**
+** Overview: Copy an ASCIIZ string without its terminator.
+**
+** Input: Pointer to the output buffer.
+**        Pointer to ASCIIZ string.
+**
+** Output: Number of characters stored.
+**
+** Note: No check on string length.
+**
+*/
+size_t
+Fmt_String(
+    char *pBuf,
+    const char *pStr
+    )
+{
+    const char *pStart;
+
+    pStart = pStr;
+    while (*pStr)
+        *pBuf++ = *pStr++;
+    return (size_t)(pStr - pStart);
+}
+
+/*
+** Function: Fmt_CrLf
+**
+** Precondition: None.
+**
+** Overview: Store a carriage return, line feed pair.
+**
+** Input: Pointer to the output buffer.
+**
+** Output: Number of characters stored.
+**
+*/
+unsigned char
+Fmt_CrLf(
+    char *pBuf
+    )
+{
+    pBuf[0] = '\r';
+    pBuf[1] = '\n';
+    return 2;
+}
+
+/*
+** Convert a value below 10000 to its thousands, hundreds and
+** tens digits using 16-bit math
+**
+** Input: Pointer to where the digits are stored.
+**        Binary value.
+**
+** Output: The units digit as a binary value.
+*/
+static unsigned short
+Fmt_DigitsShort(
+    char *pDigit,
+    unsigned short Dec
+    )
+{
+    unsigned short Weight;
+    unsigned char Index;
+
+    for (Index = 0; Index < 3; Index++)
+    {
+        Weight = DecWeightShort[Index];
+        *pDigit = '0';
+        FMT_STEP(Dec, Weight, *pDigit, 8);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 4);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 2);
+        Weight >>= 1;
+        FMT_STEP(Dec, Weight, *pDigit, 1);
+        pDigit++;
+    }
+    return Dec;
+}
+
+/*
+** Copy digits to the output with leading zeros removed and
+** padding added to fill the field width.
+**
+** Input: Pointer to the output buffer.
+**        Pointer to the digits, most significant first.
+**        Number of digits.
+**        Field width.
+**        Layout flags.
+**
+** Output: Number of characters stored.
+*/
+static unsigned char
+Fmt_Layout(
+    char *pBuf,
+    const char *pDigit,
+    unsigned char Digits,
+    unsigned char Width,
+    unsigned char Flags
+    )
+{
+    unsigned char Pad;
+    unsigned char Count;
+    char Fill;
+
+    while ((Digits > 1) && (*pDigit == '0'))
+    {
+        pDigit++;
+        Digits--;
+    }
+    Pad = (Width > Digits) ? (Width - Digits) : 0;
+    Count = Pad + Digits;
+    if ((Flags & FMT_LEFT) == 0)
+    {
+        Fill = (Flags & FMT_ZERO) ? '0' : ' ';
+        for (; Pad; Pad--)
+            *pBuf++ = Fill;
+    }
+    for (; Digits; Digits--)
+        *pBuf++ = *pDigit++;
+    for (; Pad; Pad--)
+        *pBuf++ = ' ';
+    return Count;
+}
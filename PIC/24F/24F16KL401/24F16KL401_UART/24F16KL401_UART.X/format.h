@@ -0,0 +1,66 @@
+/* 
+**     file: format.h
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  Number to text formatting for PIC24.
+**  
+**      
+*/
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+/* Largest number of digits each conversion can produce */
+#define FMT_DEC16_DIGITS 5
+#define FMT_DEC32_DIGITS 10
+#define FMT_HEX_DIGITS 2
+#define FMT_HEXWORD_DIGITS 4
+
+/* Layout flags, the default is right aligned padded with spaces */
+#define FMT_LEFT 0x01   /* left aligned, padded on the right with spaces */
+#define FMT_ZERO 0x02   /* right aligned, padded on the left with zeros */
+
+unsigned char
+Fmt_Dec16(
+    char *pBuf,
+    unsigned short Dec,
+    unsigned char Width,
+    unsigned char Flags
+    );
+
+unsigned char
+Fmt_Dec32(
+    char *pBuf,
+    unsigned long Dec,
+    unsigned char Width,
+    unsigned char Flags
+    );
+
+unsigned char
+Fmt_Hex(
+    char *pBuf,
+    unsigned char Hex
+    );
+
+unsigned char
+Fmt_HexWord(
+    char *pBuf,
+    unsigned short Hex
+    );
+
+size_t
+Fmt_String(
+    char *pBuf,
+    const char *pStr
+    );
+
+unsigned char
+Fmt_CrLf(
+    char *pBuf
+    );
+
+#endif
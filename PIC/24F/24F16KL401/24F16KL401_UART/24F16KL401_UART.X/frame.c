@@ -0,0 +1,277 @@
+/*  
+**     file: frame.c
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  COBS framed binary records with CRC-16 for PIC24.
+**  
+** Notes:
+**  A frame is the payload followed by a CRC-16/CCITT (polynomial
+**  0x1021, start 0xFFFF, high byte first). Payload and CRC are
+**  COBS stuffed so no 0x00 is left in them and a single 0x00
+**  ends the frame. A receiver that joins part way through, or
+**  sees a damaged frame, is back in step at the next 0x00.
+**
+**  COBS splits the data into blocks. Each block starts with a
+**  code byte, one more than the number of non-zero bytes that
+**  follow it. A code below 0xFF means a 0x00 came after the
+**  block in the original data.
+**
+**  The decoder takes one byte at a time so it can be fed from
+**  the UART receive path as bytes arrive. It has no hardware
+**  access and builds on any C compiler.
+**  
+*/  
+#include "frame.h"
+
+/*
+** CRC-16/CCITT for each value of a nibble, the table is run
+** twice per byte. This is much faster than bit at a time and
+** needs 32 bytes rather than the 512 of a byte table.
+*/
+static const unsigned short CrcNibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+** Declare private functions
+*/
+static unsigned short Frame_CrcByte( unsigned short Crc, unsigned char Byte );
+static void Frame_Store( FrameDecoder_t *pDec, unsigned char Byte );
+
+/*
+** Function: Frame_Crc16
+**
+** Precondition: None.
+**
+** Overview: Add bytes to a CRC-16/CCITT.
+**
+** Input: CRC so far, 0xFFFF to start.
+**        Pointer to the bytes.
+**        Number of bytes.
+**
+** Output: New CRC.
+**
+*/
+unsigned short
+Frame_Crc16(
+    unsigned short Crc,
+    const unsigned char *pData,
+    size_t Len
+    )
+{
+    while (Len--)
+    {
+        Crc = Frame_CrcByte(Crc, *pData++);
+    }
+    return Crc;
+}
+
+/*
+** Function: Frame_Encode
+**
+** Precondition: None.
+**
+** Overview: Make a frame from a payload, CRC and COBS stuffing
+** are added and the 0x00 delimiter is stored at the end.
+**
+** Input: Pointer to the output buffer, it must hold at least
+**        FRAME_ENCODED_MAX(Len) bytes.
+**        Pointer to the payload.
+**        Number of payload bytes.
+**
+** Output: Number of bytes stored.
+**
+*/
+size_t
+Frame_Encode(
+    unsigned char *pOut,
+    const unsigned char *pData,
+    unsigned char Len
+    )
+{
+    unsigned char *pCode;
+    unsigned char *pNext;
+    unsigned char Code;
+    unsigned char Byte;
+    unsigned short Crc;
+    unsigned char Index;
+
+    Crc = Frame_Crc16(0xFFFF, pData, Len);
+    pCode = pOut;
+    pNext = pOut + 1;
+    Code = 1;
+    /* Payload then the two CRC bytes */
+    for (Index = 0; Index < Len + 2; Index++)
+    {
+        if (Index < Len)
+            Byte = pData[Index];
+        else if (Index == Len)
+            Byte = (unsigned char)(Crc >> 8);
+        else
+            Byte = (unsigned char)Crc;
+
+        if (Byte == 0)
+        {
+            *pCode = Code;
+            pCode = pNext++;
+            Code = 1;
+        }
+        else
+        {
+            *pNext++ = Byte;
+            if (++Code == 0xFF)
+            {
+                *pCode = Code;
+                pCode = pNext++;
+                Code = 1;
+            }
+        }
+    }
+    *pCode = Code;
+    *pNext++ = 0;
+    return pNext - pOut;
+}
+
+/*
+** Function: Frame_DecodeInit
+**
+** Precondition: None.
+**
+** Overview: Clear a decoder and its error counters. The first
+** frame is only taken after a 0x00 has been seen, so a frame
+** already part way through is not mistaken for a whole one.
+**
+** Input: Pointer to the decoder.
+**
+** Output: None.
+**
+*/
+void
+Frame_DecodeInit(
+    FrameDecoder_t *pDec
+    )
+{
+    pDec->Len = 0;
+    pDec->Count = 0;
+    pDec->Left = 0;
+    pDec->Code = 0;
+    pDec->Drop = 1;
+    pDec->Crc = 0xFFFF;
+    pDec->CrcErrors = 0;
+    pDec->Overflows = 0;
+}
+
+/*
+** Function: Frame_Decode
+**
+** Precondition: Frame_DecodeInit must be called before.
+**
+** Overview: Take the next byte received. When it ends a good
+** frame the payload is in pDec->Data and its length in
+** pDec->Len, they stay there until the next byte is taken.
+**
+** Input: Pointer to the decoder.
+**        Byte received.
+**
+** Output: FRAME_BUSY, FRAME_READY or FRAME_ERROR.
+**
+*/
+unsigned char
+Frame_Decode(
+    FrameDecoder_t *pDec,
+    unsigned char Byte
+    )
+{
+    unsigned char Result;
+
+    if (Byte == 0)
+    {
+        /* End of frame, the last block must be complete */
+        Result = FRAME_BUSY;
+        if (pDec->Drop == 0)
+        {
+            if ((pDec->Left != 0) || (pDec->Count < 2))
+            {
+                pDec->Overflows++;
+                Result = FRAME_ERROR;
+            }
+            else if (pDec->Crc != 0)
+            {
+                /* The CRC over payload and CRC is zero when they match */
+                pDec->CrcErrors++;
+                Result = FRAME_ERROR;
+            }
+            else
+            {
+                pDec->Len = pDec->Count - 2;
+                Result = FRAME_READY;
+            }
+        }
+        pDec->Count = 0;
+        pDec->Left = 0;
+        pDec->Code = 0;
+        pDec->Drop = 0;
+        pDec->Crc = 0xFFFF;
+        return Result;
+    }
+    if (pDec->Drop != 0)
+        return FRAME_BUSY;
+
+    if (pDec->Left == 0)
+    {
+        /* Code byte, the block before it ended with a zero unless it was full */
+        if ((pDec->Code != 0) && (pDec->Code != 0xFF))
+        {
+            Frame_Store(pDec, 0);
+        }
+        pDec->Code = Byte;
+        pDec->Left = Byte - 1;
+    }
+    else
+    {
+        Frame_Store(pDec, Byte);
+        pDec->Left--;
+    }
+    if (pDec->Drop != 0)
+    {
+        pDec->Overflows++;
+        return FRAME_ERROR;
+    }
+    return FRAME_BUSY;
+}
+
+/*
+** Add one byte to the CRC, high nibble first
+*/
+static unsigned short
+Frame_CrcByte(
+    unsigned short Crc,
+    unsigned char Byte
+    )
+{
+    Crc = (Crc << 4) ^ CrcNibble[(unsigned char)(Crc >> 12) ^ (Byte >> 4)];
+    Crc = (Crc << 4) ^ CrcNibble[(unsigned char)(Crc >> 12) ^ (Byte & 0x0F)];
+    return Crc;
+}
+
+/*
+** Store a decoded byte, drop the frame when it is too long
+*/
+static void
+Frame_Store(
+    FrameDecoder_t *pDec,
+    unsigned char Byte
+    )
+{
+    if (pDec->Count >= sizeof(pDec->Data))
+    {
+        pDec->Drop = 1;
+        return;
+    }
+    pDec->Data[pDec->Count++] = Byte;
+    pDec->Crc = Frame_CrcByte(pDec->Crc, Byte);
+}
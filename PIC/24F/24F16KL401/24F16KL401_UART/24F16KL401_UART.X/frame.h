@@ -0,0 +1,69 @@
+/* 
+**     file: frame.h
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  COBS framed binary records with CRC-16 for PIC24.
+**  
+**      
+*/
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+
+/* Largest payload a frame can carry */
+#define FRAME_MAX_PAYLOAD 64
+
+#if FRAME_MAX_PAYLOAD > 253
+#error FRAME_MAX_PAYLOAD must leave room for the CRC in 255 bytes. Correct value in frame.h file.
+#endif
+
+/* Bytes on the wire for a payload of Len bytes, CRC, COBS overhead and delimiter */
+#define FRAME_ENCODED_MAX(Len) ((Len) + 2 + ((Len) + 2) / 254 + 1 + 1)
+
+/* Frame_Decode results */
+#define FRAME_BUSY  0   /* frame not finished yet */
+#define FRAME_READY 1   /* payload and length are in the decoder */
+#define FRAME_ERROR 2   /* bad CRC, bad stuffing or too long, frame dropped */
+
+typedef struct {
+    unsigned char Data[FRAME_MAX_PAYLOAD + 2];  /* payload then CRC */
+    unsigned char Len;          /* payload bytes in a ready frame */
+    unsigned char Count;        /* bytes stored so far */
+    unsigned char Left;         /* bytes left in the current COBS block */
+    unsigned char Code;         /* code byte of the current COBS block */
+    unsigned char Drop;         /* skip to the next delimiter */
+    unsigned short Crc;         /* CRC of the bytes stored so far */
+    unsigned short CrcErrors;   /* frames dropped for a bad CRC */
+    unsigned short Overflows;   /* frames dropped for length or stuffing */
+} FrameDecoder_t;
+
+unsigned short
+Frame_Crc16(
+    unsigned short Crc,
+    const unsigned char *pData,
+    size_t Len
+    );
+
+size_t
+Frame_Encode(
+    unsigned char *pOut,
+    const unsigned char *pData,
+    unsigned char Len
+    );
+
+void
+Frame_DecodeInit(
+    FrameDecoder_t *pDec
+    );
+
+unsigned char
+Frame_Decode(
+    FrameDecoder_t *pDec,
+    unsigned char Byte
+    );
+
+#endif
@@ -14,7 +14,9 @@
 /*
  * Define constants for how we will configure the clock
  */
+#ifndef FOSC
 #define FOSC (2000000UL)
+#endif
 #define FCYC (FOSC/2UL)
 
 #endif
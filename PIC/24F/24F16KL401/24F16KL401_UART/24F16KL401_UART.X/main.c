@@ -61,22 +61,113 @@
 #include <xc.h>
 #include "init.h"
 #include "uart.h"
-/* warning non-portable function */
+#include "format.h"
+#include "tick.h"
+
+/* Polls to wait for the auto-baud sync byte, about 1 second */
+#ifndef AUTOBAUD_TIMEOUT
+#define AUTOBAUD_TIMEOUT 150000UL
+#endif
+
+/* Milliseconds from reset to the startup banner */
+#ifndef STARTUP_DELAY
+#define STARTUP_DELAY 2000
+#endif
+
+/*
+ * Set to 1 to pass data between UART1 and UART2 in both
+ * directions instead of echoing UART2. Both UARTs must be in
+ * interrupt mode, turn on Ux_FLOW_CONTROL in uart.h when the
+ * RTS/CTS pins are wired so neither side can overrun.
+ */
+#ifndef APP_BRIDGE
+#define APP_BRIDGE 0
+#endif
+#ifndef BRIDGE_CHUNK
+#define BRIDGE_CHUNK 16
+#endif
+
 /*
- * This function waits for the at least the
- * specified number milliseconds then returns.
+ * Startup banner, sent straight from program memory
  */
-void delay( unsigned long wait_ms )
+static const char BannerTitle[] = "\r\nUART Test ";
+static const char BannerBuild[] = __DATE__", "__TIME__"\r\n";
+static const UartTxDesc_t Banner[] = {
+    { BannerTitle, sizeof(BannerTitle) - 1 },
+    { BannerBuild, sizeof(BannerBuild) - 1 },
+};
+
+#if APP_BRIDGE && (!U1_INTERRUPT_MODE || !U2_INTERRUPT_MODE)
+#error Bridge mode needs both UARTs in interrupt mode. Correct values in uart.h file.
+#endif
+#if APP_BRIDGE
+/*
+ * Move what each UART has received to the other one. Only as
+ * many bytes are taken from a receive ring as the other transmit
+ * ring has room for, the rest waits so flow control can push
+ * back on the sender.
+ */
+void bridge( void )
 {
-    for (;wait_ms; --wait_ms)
-    {
-        asm("    repeat  %0 \n"
-            "    clrwdt     \n"
-            : /* no outputs */
-            : "r" ((unsigned short)(FCYC/1000-14))
-            );
-    }
+    char Buf[BRIDGE_CHUNK];
+    size_t Len;
+
+    Len = U2_TxFree();
+    if (Len > sizeof(Buf))
+        Len = sizeof(Buf);
+    Len = U1_Read(Buf, Len, 0);
+    U2_Write(Buf, Len);
+
+    Len = U1_TxFree();
+    if (Len > sizeof(Buf))
+        Len = sizeof(Buf);
+    Len = U2_Read(Buf, Len, 0);
+    U1_Write(Buf, Len);
 }
+#endif
+
+#if !APP_BRIDGE
+/*
+ * One-shot task run STARTUP_DELAY after reset. Match the host
+ * baud rate then send the banner and the reset status record.
+ */
+void startup( void )
+{
+    char Line[64];
+    char *pLine;
+    TickStats_t Stats;
+
+    /*
+     * The tick latency and the idle time are for the startup
+     * delay while the main loop only had the echo to do. Take
+     * them before the auto-baud, which polls for a second.
+     */
+    Tick_GetStats(&Stats, 1);
+    /*
+     * Give the host a chance to send a 'U' so UART2 can match its
+     * baud rate, stay at U2_BAUD when nothing comes. This holds
+     * up the main loop for about a second, it only runs once.
+     */
+    U2_AutoBaud(AUTOBAUD_TIMEOUT);
+
+    U2_PutConstList(Banner, sizeof(Banner)/sizeof(Banner[0]));
+    /*
+     * Render the reset status record then send it in one piece.
+     */
+    pLine = Line;
+    pLine += Fmt_String(pLine, "RCON 0x");
+    pLine += Fmt_HexWord(pLine, RCON);
+    pLine += Fmt_String(pLine, " BAUD ");
+    pLine += Fmt_Dec32(pLine, U2_GetBaud(), 0, 0);
+    pLine += Fmt_String(pLine, " TICK ");
+    pLine += Fmt_Dec32(pLine, Stats.MaxLatency, 0, 0);
+    pLine += Fmt_String(pLine, " IDLE ");
+    pLine += Fmt_Dec32(pLine, Stats.TotalCycles ? Stats.IdleCycles / (Stats.TotalCycles / 100) : 0, 0, 0);
+    pLine += Fmt_String(pLine, "%");
+    pLine += Fmt_CrLf(pLine);
+    U2_PutBuffer(Line, pLine - Line);
+}
+#endif
 
 /*
  * main application
@@ -132,16 +223,19 @@ int main( void )
     for (uiTimeout=10000; --uiTimeout && OSCCONbits.OSWEN;);
     
     U2_Init();
+#if APP_BRIDGE
+    U1_Init();
+#endif
+    Tick_Init();
+#if !APP_BRIDGE
     /*
-     * This 2 second delay is here to give the ISCP device 
+     * The banner waits 2 seconds to give the ISCP device
      * programmer a chance to reset the target a few times
-     * before the main application starts up.
-     * 
-     * We need to remove this for the real application.
+     * before the main application starts up. The echo runs
+     * while it waits.
      */
-    delay(2000);
-    
-    U2_PutString("\r\nUART Test "__DATE__", "__TIME__"\r\n");
+    Task_Start(startup, STARTUP_DELAY, 0);
+#endif
     
     /*
      * End of main loop 
@@ -149,9 +243,19 @@ int main( void )
     for(;;)
     {
         /* Embedded systems do not return from main */
+        Task_Run();
+#if APP_BRIDGE
+        bridge();
+#else
         if (U2_HasData())
         {
             U2_PutChar (U2_GetChar());
         }
+        else
+        {
+            /* Idle, or Sleep with U2_RX_SLEEP set when no tasks are waiting */
+            Task_Idle(U2_WaitForData);
+        }
+#endif
     }
 }
@@ -0,0 +1,399 @@
+/*
+**     file: tick.c
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**
+** Description:
+**  Timer1 millisecond tick and cooperative task scheduler.
+**
+** Notes:
+**  Timer1 runs from the instruction clock with PR1 set for one
+**  interrupt every millisecond. Tick_Now returns the count of
+**  ticks, it wraps after about 65 seconds so times must be
+**  compared by subtracting them.
+**
+**  Tasks are functions called from Task_Run in the main loop
+**  once they are due, after a delay and then again every period
+**  or only once when the period is zero. A task runs to the end
+**  before the next one starts, so it must not wait for long.
+**
+**  Timer1 keeps running in Idle but stops in Sleep. Task_Idle
+**  uses Idle while any task is started and only hands over to
+**  the caller's hook, which may Sleep, when none are left.
+**
+**  Data shared with the tick interrupt is guarded with DISI.
+**  main sets NSTDIS, which makes SR.IPL read only. A tick held
+**  off by one of these windows is not sampled for MaxLatency,
+**  the DISI windows of this file would otherwise be counted as
+**  jitter of the tick.
+**
+*/
+#include <xc.h>
+#include <stddef.h>
+#include "tick.h"
+
+typedef struct {
+    TaskFunc_t pFunc;           /* NULL when the entry is free */
+    unsigned short Due;         /* tick the task runs next */
+    unsigned short Period;      /* ticks between runs, 0 to run once */
+} Task_t;
+
+static Task_t Tasks[TASK_MAX];
+
+static volatile unsigned short TickMs;
+static volatile unsigned long StatsTicks;
+static volatile unsigned short MaxLatency;
+static volatile unsigned char TickHeld;
+static unsigned long IdleCycles;
+
+/*
+** Declare private functions
+*/
+static int Task_Due( unsigned short Now );
+
+/* End a DISI window, flag a tick it held off */
+#define TICK_DISI_END() do { if (_T1IF) TickHeld = 1; __builtin_disi(0x0000); } while (0)
+
+/*
+** Function: Tick_Init
+**
+** Precondition: None.
+**
+** Overview: Start Timer1 from the instruction clock with an
+** interrupt every millisecond.
+**
+** Input: None.
+**
+** Output: None.
+**
+*/
+void
+Tick_Init(
+    void
+    )
+{
+    _T1IE = 0;
+    T1CON = 0;              /* internal clock, 1:1 prescale, runs in Idle */
+    TMR1 = 0;
+    PR1 = TICK_CYCLES - 1;
+    TickMs = 0;
+    StatsTicks = 0;
+    MaxLatency = 0;
+    TickHeld = 0;
+    IdleCycles = 0;
+    _T1IP = 0b100;
+    _T1IF = 0;
+    _T1IE = 1;
+    _TON = 1;
+}
+
+/*
+** Function: Tick_Now
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Read the millisecond tick count.
+**
+** Input: None.
+**
+** Output: Ticks since Tick_Init, wraps from 65535 to 0.
+**
+*/
+unsigned short
+Tick_Now(
+    void
+    )
+{
+    return TickMs;
+}
+
+/*
+** Function: Tick_Wait
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Wait in Idle for at least the number of
+** milliseconds. Interrupts are still serviced, tasks are not
+** run.
+**
+** Input: Ms - milliseconds to wait.
+**
+** Output: None.
+**
+*/
+void
+Tick_Wait(
+    unsigned short Ms
+    )
+{
+    unsigned short Start;
+
+    Start = TickMs;
+    while ((unsigned short)(TickMs - Start) <= Ms)
+    {
+        ClrWdt();
+        Idle();
+    }
+}
+
+/*
+** Function: Tick_GetStats
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Copy the tick latency and idle time measured since
+** Tick_Init or the last reset. MaxLatency is the jitter of the
+** tick, the most cycles the interrupt was held off after the
+** Timer1 period match. IdleCycles over TotalCycles is the part
+** of the time the core was in Idle from Task_Idle, TotalCycles
+** counts whole ticks. Both wrap after about 71 minutes at 1MHz.
+**
+** Input: pStats - where to copy the counters, may be NULL.
+**        Reset  - non-zero to clear the counters after the copy.
+**
+** Output: None.
+**
+*/
+void
+Tick_GetStats(
+    TickStats_t *pStats,
+    char Reset
+    )
+{
+    __builtin_disi(0x3FFF);
+    if (pStats)
+    {
+        pStats->MaxLatency = MaxLatency;
+        pStats->IdleCycles = IdleCycles;
+        pStats->TotalCycles = StatsTicks * TICK_CYCLES;
+    }
+    if (Reset)
+    {
+        StatsTicks = 0;
+        MaxLatency = 0;
+        IdleCycles = 0;
+    }
+    TICK_DISI_END();
+}
+
+/*
+** Function: Task_Start
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Add a task to the table. It is called from
+** Task_Run once Delay ticks have passed and then every Period
+** ticks. A task may start or stop tasks, itself included.
+**
+** Input: pFunc  - function to call.
+**        Delay  - ticks until the first run.
+**        Period - ticks between runs, 0 to run once.
+**
+** Output: Task number for Task_Stop, TASK_NONE when the table
+** is full.
+**
+*/
+int
+Task_Start(
+    TaskFunc_t pFunc,
+    unsigned short Delay,
+    unsigned short Period
+    )
+{
+    int Task;
+
+    for (Task = 0; Task < TASK_MAX; Task++)
+    {
+        if (Tasks[Task].pFunc == NULL)
+        {
+            Tasks[Task].Due = TickMs + Delay;
+            Tasks[Task].Period = Period;
+            Tasks[Task].pFunc = pFunc;
+            return Task;
+        }
+    }
+    return TASK_NONE;
+}
+
+/*
+** Function: Task_Stop
+**
+** Precondition: None.
+**
+** Overview: Remove a task from the table. A one-shot task is
+** removed by itself once it has run.
+**
+** Input: Task - number from Task_Start.
+**
+** Output: None.
+**
+*/
+void
+Task_Stop(
+    int Task
+    )
+{
+    if ((Task >= 0) && (Task < TASK_MAX))
+    {
+        Tasks[Task].pFunc = NULL;
+    }
+}
+
+/*
+** Function: Task_Run
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Call each task that is due. A periodic task that
+** fell more than one period behind skips the runs it missed
+** rather than running back to back to catch up.
+**
+** Input: None.
+**
+** Output: None.
+**
+*/
+void
+Task_Run(
+    void
+    )
+{
+    unsigned short Now;
+    TaskFunc_t pFunc;
+    int Task;
+
+    Now = TickMs;
+    for (Task = 0; Task < TASK_MAX; Task++)
+    {
+        pFunc = Tasks[Task].pFunc;
+        if ((pFunc != NULL) && ((short)(Now - Tasks[Task].Due) >= 0))
+        {
+            if (Tasks[Task].Period)
+            {
+                Tasks[Task].Due += Tasks[Task].Period;
+                if ((short)(Now - Tasks[Task].Due) >= 0)
+                    Tasks[Task].Due = Now + Tasks[Task].Period;
+            }
+            else
+            {
+                Tasks[Task].pFunc = NULL;
+            }
+            pFunc();
+        }
+    }
+}
+
+/*
+** Function: Task_Idle
+**
+** Precondition: Tick_Init must be called before.
+**
+** Overview: Stop the core until there may be work. While any
+** task is started the core goes to Idle, the next tick or any
+** other interrupt wakes it, and the time is added to the idle
+** count. With no tasks left pHook is called instead so the
+** caller can Sleep, the tick stops until it wakes.
+**
+** Input: pHook - called when no task is started, Idle is used
+**        when NULL.
+**
+** Output: None, returns after any interrupt so the caller
+** must check for work again.
+**
+*/
+void
+Task_Idle(
+    TaskFunc_t pHook
+    )
+{
+    unsigned short StartMs;
+    unsigned short StartCount;
+    unsigned short EndMs;
+    unsigned short EndCount;
+    int Due;
+
+    __builtin_disi(0x3FFF);
+    Due = Task_Due(TickMs);
+    if (Due < 0)
+    {
+        TICK_DISI_END();
+        if (pHook != NULL)
+            pHook();
+        else
+            Idle();
+    }
+    else if (Due == 0)
+    {
+        /* Pending interrupts wake the core but are not taken until DISI is ended */
+        StartMs = TickMs;
+        StartCount = TMR1;
+        Idle();
+        EndMs = TickMs;
+        EndCount = TMR1;
+        if (_T1IF && (EndCount < StartCount))
+            EndMs++;        /* period match, tick interrupt not taken yet */
+        TICK_DISI_END();
+        IdleCycles += (unsigned long)(unsigned short)(EndMs - StartMs) * TICK_CYCLES
+                    + EndCount - StartCount;
+    }
+    else
+    {
+        TICK_DISI_END();
+    }
+}
+
+/*
+** Function: Task_Due
+**
+** Precondition: None.
+**
+** Overview: Look for work in the task table.
+**
+** Input: Now - current tick count.
+**
+** Output: -1 when no task is started, 1 when a task is due,
+** 0 when tasks are waiting for their time.
+**
+*/
+static int
+Task_Due(
+    unsigned short Now
+    )
+{
+    int Due;
+    int Task;
+
+    Due = -1;
+    for (Task = 0; Task < TASK_MAX; Task++)
+    {
+        if (Tasks[Task].pFunc != NULL)
+        {
+            if ((short)(Now - Tasks[Task].Due) >= 0)
+                return 1;
+            Due = 0;
+        }
+    }
+    return Due;
+}
+
+/*
+** Timer1 interrupt
+**
+** Count the tick. TMR1 restarted from zero at the period
+** match, so its value on entry is how late the interrupt is.
+** A tick held off by a DISI window of this file is not sampled.
+*/
+void __attribute__((interrupt,no_auto_psv)) _T1Interrupt(void)
+{
+    unsigned short Latency;
+
+    Latency = TMR1;
+    _T1IF = 0;
+    TickMs++;
+    StatsTicks++;
+    if (TickHeld)
+        TickHeld = 0;
+    else if (Latency > MaxLatency)
+        MaxLatency = Latency;
+}
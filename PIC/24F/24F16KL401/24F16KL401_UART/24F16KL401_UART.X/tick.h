@@ -0,0 +1,60 @@
+/*
+**     file: tick.h
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**
+** Description:
+**  Timer1 millisecond tick and cooperative task scheduler.
+**
+** Notes:
+**  The template project builds this file from here as well. It
+**  gives FCYC in its preprocessor macros, a quoted include in
+**  tick.c would find the init.h of this project instead of its
+**  own.
+**
+*/
+#ifndef TICK_H
+#define TICK_H
+
+#ifndef FCYC
+#include "init.h"
+#endif
+
+/* Timer1 interrupt rate */
+#define TICK_HZ (1000UL)
+
+/* Instruction cycles in one tick */
+#define TICK_CYCLES (FCYC/TICK_HZ)
+
+#if (TICK_CYCLES < 100) || (TICK_CYCLES > 65536UL)
+#error Timer1 cannot make the tick from FCYC without a prescaler. Correct values in init.h or tick.h file.
+#endif
+
+/* Number of tasks that can be started at once */
+#define TASK_MAX 4
+
+/* Returned by Task_Start when the task table is full */
+#define TASK_NONE (-1)
+
+typedef void (*TaskFunc_t)( void );
+
+/*
+ * Tick and idle measurements, see Tick_GetStats
+ */
+typedef struct {
+    unsigned short MaxLatency;  /* most cycles from period match to the tick interrupt */
+    unsigned long IdleCycles;   /* cycles spent in Idle from Task_Idle */
+    unsigned long TotalCycles;  /* cycles since the stats were cleared */
+} TickStats_t;
+
+void Tick_Init( void );
+unsigned short Tick_Now( void );
+void Tick_Wait( unsigned short Ms );
+void Tick_GetStats( TickStats_t *pStats, char Reset );
+int Task_Start( TaskFunc_t pFunc, unsigned short Delay, unsigned short Period );
+void Task_Stop( int Task );
+void Task_Run( void );
+void Task_Idle( TaskFunc_t pHook );
+
+#endif
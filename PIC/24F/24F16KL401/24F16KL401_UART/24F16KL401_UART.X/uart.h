@@ -12,33 +12,214 @@
 #ifndef UART_H
 #define UART_H
 
+#include <stddef.h>
+#include "init.h"
+#include "frame.h"
+
+/*
+ * Largest baud rate error the build will accept, in hundredths
+ * of a percent. The receiver at the other end must tolerate the
+ * error of both ends added together.
+ */
+#define UART_BAUD_ERROR_MAX 250
+
+/*
+ * Range of baud rates Ux_AutoBaud will switch to. A measured
+ * rate outside this range is taken as line noise.
+ */
+#define UART_AUTOBAUD_MIN 1200UL
+#define UART_AUTOBAUD_MAX 115200UL
+
+/*
+ * The Ux_ options below may be given on the compiler command line
+ * instead, the host tests in ../test build several mixes of them.
+ */
+
+/*
+ * Receive line error counters, see Ux_GetStats
+ */
+typedef struct {
+    unsigned short Overrun;     /* times OERR was found set */
+    unsigned short Framing;     /* characters received with FERR */
+    unsigned short Parity;      /* characters received with PERR */
+    unsigned short Dropped;     /* characters thrown away */
+    unsigned short RxHighWater; /* most bytes held in the RX ring buffer */
+} UartStats_t;
+
+/*
+ * Block of data sent in place, see Ux_QueueConst
+ */
+typedef struct {
+    const char *pData;
+    size_t Len;
+} UartTxDesc_t;
+
+/* Set to 1 to build the driver for UART1 */
+#ifndef U1_USED
+#define U1_USED 1
+#endif
+
 /* UART1 I/O PINS */ /* must list GPIO pin */
 #define U1_TXD      _LATB7
 #define U1_TXD_DIR  _TRISB7
 #define U1_RXD      _RB2
 #define U1_RXD_DIR  _TRISB2
          
+#ifndef U1_BAUD
 #define U1_BAUD 9600UL
-#define U1_BRGH_VALUE 1
+#endif
+
+/*
+ * Set to 1 to run UART1 from interrupts with RAM ring buffers.
+ * TXDESC_COUNT is the number of U1_QueueConst blocks that can wait.
+ * Buffer sizes and TXDESC_COUNT must be a power of two.
+ */
+#ifndef U1_INTERRUPT_MODE
+#define U1_INTERRUPT_MODE 1
+#endif
+#ifndef U1_TXBUF_SIZE
+#define U1_TXBUF_SIZE 16
+#endif
+#ifndef U1_RXBUF_SIZE
+#define U1_RXBUF_SIZE 16
+#endif
+#ifndef U1_TXDESC_COUNT
+#define U1_TXDESC_COUNT 4
+#endif
+
+/*
+ * Set to 1 to use hardware RTS/CTS flow control on UART1. The
+ * UART holds RTS off while its receive FIFO is full so in
+ * interrupt mode the RX interrupt stops draining the FIFO when
+ * the ring buffer is full instead of dropping bytes.
+ */
+#ifndef U1_FLOW_CONTROL
+#define U1_FLOW_CONTROL 0
+#endif
+
+/*
+ * Set to 1 to let U1_WaitForData put the part to Sleep when the
+ * UART is idle, 0 to use Idle only. See uart.c. In Sleep the
+ * start bit that wakes the part is lost with its character, the
+ * host must lead each burst with 0x00 or a break. In Idle the
+ * UART keeps receiving and nothing is lost.
+ */
+#ifndef U1_RX_SLEEP
+#define U1_RX_SLEEP 0
+#endif
+
+/*
+ * With U1_RX_SLEEP, the times U1_WaitForData uses Idle after a
+ * wake from Sleep, or after data came in, before it may Sleep
+ * again. The rest of a burst then comes in with the UART clock
+ * running. Each time is an interrupt, about a millisecond with
+ * the 1kHz tick.
+ */
+#ifndef U1_WAKE_IDLE
+#define U1_WAKE_IDLE 20
+#endif
 
-#define _U1_BRGH   _BRGH
-#define _U1_UARTEN _UARTEN
-#define _U1_UTXEN  _UTXEN
-#define _U1_UTXBF  _UTXBF
-#define _U1_TRMT   _TRMT
+/* U1MODE */
+#define _U1_STSEL    U1MODEbits.STSEL
+#define _U1_PDSEL    U1MODEbits.PDSEL
+#define _U1_BRGH     U1MODEbits.BRGH
+#define _U1_RXINV    U1MODEbits.RXINV
+#define _U1_ABAUD    U1MODEbits.ABAUD
+#define _U1_LPBACK   U1MODEbits.LPBACK
+#define _U1_WAKE     U1MODEbits.WAKE
+#define _U1_UEN      U1MODEbits.UEN
+#define _U1_RTSMD    U1MODEbits.RTSMD
+#define _U1_IREN     U1MODEbits.IREN
+#define _U1_USIDL    U1MODEbits.USIDL
+#define _U1_UARTEN   U1MODEbits.UARTEN
+#define _U1_PDSEL0   U1MODEbits.PDSEL0
+#define _U1_PDSEL1   U1MODEbits.PDSEL1
+#define _U1_UEN0     U1MODEbits.UEN0
+#define _U1_UEN1     U1MODEbits.UEN1
 
-#define _U1_OERR   _OERR
-#define _U1_URXDA  _URXDA
+/* U1STA */
+#define _U1_URXDA    U1STAbits.URXDA
+#define _U1_OERR     U1STAbits.OERR
+#define _U1_FERR     U1STAbits.FERR
+#define _U1_PERR     U1STAbits.PERR
+#define _U1_RIDLE    U1STAbits.RIDLE
+#define _U1_ADDEN    U1STAbits.ADDEN
+#define _U1_URXISEL  U1STAbits.URXISEL
+#define _U1_TRMT     U1STAbits.TRMT
+#define _U1_UTXBF    U1STAbits.UTXBF
+#define _U1_UTXEN    U1STAbits.UTXEN
+#define _U1_UTXBRK   U1STAbits.UTXBRK
+#define _U1_UTXISEL0 U1STAbits.UTXISEL0
+#define _U1_UTXINV   U1STAbits.UTXINV
+#define _U1_UTXISEL1 U1STAbits.UTXISEL1
+#define _U1_URXISEL0 U1STAbits.URXISEL0
+#define _U1_URXISEL1 U1STAbits.URXISEL1
 
 
-/* UART2 I/O PINS */
+/* Set to 1 to build the driver for UART2 */
+#ifndef U2_USED
+#define U2_USED 1
+#endif
+
+/* UART2 I/O PINS */ /* must list GPIO pin */
 #define U2_TXD      _LATB0
 #define U2_TXD_DIR  _TRISB0
 #define U2_RXD      _RB1
 #define U2_RXD_DIR  _TRISB1
 
+#ifndef U2_BAUD
 #define U2_BAUD 9600UL
-#define U2_BRGH_VALUE 1
+#endif
+
+/*
+ * Set to 1 to run UART2 from interrupts with RAM ring buffers.
+ * TXDESC_COUNT is the number of U2_QueueConst blocks that can wait.
+ * Buffer sizes and TXDESC_COUNT must be a power of two.
+ */
+#ifndef U2_INTERRUPT_MODE
+#define U2_INTERRUPT_MODE 1
+#endif
+#ifndef U2_TXBUF_SIZE
+#define U2_TXBUF_SIZE 64
+#endif
+#ifndef U2_RXBUF_SIZE
+#define U2_RXBUF_SIZE 16
+#endif
+#ifndef U2_TXDESC_COUNT
+#define U2_TXDESC_COUNT 4
+#endif
+
+/*
+ * Set to 1 to use hardware RTS/CTS flow control on UART2. The
+ * UART holds RTS off while its receive FIFO is full so in
+ * interrupt mode the RX interrupt stops draining the FIFO when
+ * the ring buffer is full instead of dropping bytes.
+ */
+#ifndef U2_FLOW_CONTROL
+#define U2_FLOW_CONTROL 0
+#endif
+
+/*
+ * Set to 1 to let U2_WaitForData put the part to Sleep when the
+ * UART is idle, 0 to use Idle only. See uart.c. In Sleep the
+ * start bit that wakes the part is lost with its character, the
+ * host must lead each burst with 0x00 or a break. In Idle the
+ * UART keeps receiving and nothing is lost.
+ */
+#ifndef U2_RX_SLEEP
+#define U2_RX_SLEEP 0
+#endif
+
+/*
+ * With U2_RX_SLEEP, the times U2_WaitForData uses Idle after a
+ * wake from Sleep, or after data came in, before it may Sleep
+ * again. The rest of a burst then comes in with the UART clock
+ * running. Each time is an interrupt, about a millisecond with
+ * the 1kHz tick.
+ */
+#ifndef U2_WAKE_IDLE
+#define U2_WAKE_IDLE 20
+#endif
 
 /* U2MODE */
 #define _U2_STSEL    U2MODEbits.STSEL
@@ -76,95 +257,91 @@
 #define _U2_URXISEL0 U2STAbits.URXISEL0
 #define _U2_URXISEL1 U2STAbits.URXISEL1
 
+/*
+ * Baud rate solver
+ *
+ * The preprocessor works out the BRG value for each UART from
+ * FCYC in init.h and Ux_BAUD. BRG is rounded to nearest for both
+ * BRGH=0 (16 clocks per bit) and BRGH=1 (4 clocks per bit) and
+ * the setting with the smaller error is used. On a tie BRGH=0
+ * is kept because it takes three samples per bit.
+ *
+ *  Ux_BRGH_VALUE  - BRGH bit chosen
+ *  Ux_BRGREG      - value for UxBRG
+ *  Ux_BAUD_ERROR  - error in hundredths of a percent
+ *  Ux_REAL_BAUD   - baud rate the UART really runs at
+ *
+ * UART_BRG wraps to a huge value when the baud rate is too high
+ * for the clock, UART_BAUD_ERR then reports the worst error.
+ */
+#define UART_BRG(Baud, Scale) \
+    ((FCYC + ((Scale) * (Baud)) / 2UL) / ((Scale) * (Baud)) - 1UL)
+#define UART_BRG_CLOCKS(Baud, Scale) \
+    ((Scale) * (Baud) * (UART_BRG(Baud, Scale) + 1UL))
+#define UART_BAUD_ERR(Baud, Scale) \
+    ((UART_BRG(Baud, Scale) > 65535UL) ? 0xFFFFFFFFUL : \
+    ((FCYC > UART_BRG_CLOCKS(Baud, Scale)) ? \
+        (FCYC - UART_BRG_CLOCKS(Baud, Scale)) : \
+        (UART_BRG_CLOCKS(Baud, Scale) - FCYC)) * 10000UL / UART_BRG_CLOCKS(Baud, Scale))
 
-void
-U1_Init(
-    void
-    );
-
-void  
-U1_PutChar(
-    char Ch
-    );
-
-char 
-U1_HasData(
-    void
-    );
-
-char 
-U1_GetChar(
-    void
-    );
-
-void
-U1_PutDec(
-    unsigned int Dec
-    );
-
-void
-U1_PutDecLong(
-    unsigned long Dec
-    );
-
-void
-U1_PutHex(
-    unsigned char Dec
-    );
-
-void
-U1_PutHexWord(
-    unsigned short Hex
-    );
-
-void
-U1_PutString(
-    char *pBuf
-    );
-
-void
-U2_Init(
-    void
-    );
-
-void  
-U2_PutChar(
-    char Ch
-    );
-
-char 
-U2_HasData(
-    void
-    );
-
-char 
-U2_GetChar(
-    void
-    );
-
-void
-U2_PutDec(
-    unsigned int Dec
-    );
-
-void
-U2_PutDecLong(
-    unsigned long Dec
-    );
-
-void
-U2_PutHex(
-    unsigned char Dec
-    );
-
-void
-U2_PutHexWord(
-    unsigned short Hex
-    );
-
-void
-U2_PutString(
-    char *pBuf
-    );
+#if UART_BAUD_ERR(U1_BAUD, 4UL) < UART_BAUD_ERR(U1_BAUD, 16UL)
+#define U1_BRGH_VALUE 1
+#define U1_BRGH_SCALE 4UL
+#else
+#define U1_BRGH_VALUE 0
+#define U1_BRGH_SCALE 16UL
+#endif
+#define U1_BRGREG UART_BRG(U1_BAUD, U1_BRGH_SCALE)
+#define U1_BAUD_ERROR UART_BAUD_ERR(U1_BAUD, U1_BRGH_SCALE)
+#define U1_REAL_BAUD (FCYC / (U1_BRGH_SCALE * (U1_BRGREG + 1UL)))
+
+#if UART_BAUD_ERR(U2_BAUD, 4UL) < UART_BAUD_ERR(U2_BAUD, 16UL)
+#define U2_BRGH_VALUE 1
+#define U2_BRGH_SCALE 4UL
+#else
+#define U2_BRGH_VALUE 0
+#define U2_BRGH_SCALE 16UL
+#endif
+#define U2_BRGREG UART_BRG(U2_BAUD, U2_BRGH_SCALE)
+#define U2_BAUD_ERROR UART_BAUD_ERR(U2_BAUD, U2_BRGH_SCALE)
+#define U2_REAL_BAUD (FCYC / (U2_BRGH_SCALE * (U2_BRGREG + 1UL)))
+
+
+/*
+ * Functions made for each UART, see uart_instance.h
+ */
+#define UART_DECLARE(Ux)                                        \
+void Ux##_Init( void );                                         \
+void Ux##_PutChar( char Ch );                                   \
+char Ux##_HasData( void );                                      \
+char Ux##_GetChar( void );                                      \
+char Ux##_TryPutChar( char Ch );                                \
+char Ux##_TryGetChar( char *pCh );                              \
+size_t Ux##_Write( const char *pBuf, size_t Len );              \
+size_t Ux##_Read( char *pBuf, size_t Max, unsigned int Timeout ); \
+char Ux##_AutoBaud( unsigned long Timeout );                    \
+unsigned long Ux##_GetBaud( void );                             \
+size_t Ux##_TxFree( void );                                     \
+void Ux##_WaitForData( void );                                  \
+void Ux##_GetStats( UartStats_t *pStats, char Reset );          \
+void Ux##_PutDec( unsigned int Dec );                           \
+void Ux##_PutDecLong( unsigned long Dec );                      \
+void Ux##_PutHex( unsigned char Hex );                          \
+void Ux##_PutHexWord( unsigned short Hex );                     \
+void Ux##_PutString( char *pBuf );                              \
+void Ux##_PutBuffer( const char *pBuf, size_t Len );            \
+void Ux##_PutFrame( const unsigned char *pData, unsigned char Len ); \
+unsigned char Ux##_GetFrame( FrameDecoder_t *pDec );         \
+char Ux##_QueueConst( const char *pData, size_t Len );          \
+void Ux##_PutConst( const char *pData, size_t Len );            \
+void Ux##_PutConstList( const UartTxDesc_t *pList, unsigned char Count );
+
+#if U1_USED
+UART_DECLARE(U1)
+#endif
+
+#if U2_USED
+UART_DECLARE(U2)
+#endif
 
 #endif
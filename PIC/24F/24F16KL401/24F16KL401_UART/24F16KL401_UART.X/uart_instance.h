@@ -0,0 +1,1085 @@
+/* 
+**     file: uart_instance.h
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  One instance of the UART driver for PIC24.
+**  
+** Notes:
+**  uart.c includes this file once for each UART with UART_N set
+**  to the UART number. The UX_ macros paste that number into the
+**  names so every function, buffer and register access is made
+**  for one UART and nothing is reached through a pointer. The
+**  Ux_ options for the UART in uart.h work here as they are
+**  with #if, so UARTs in different modes can be mixed.
+**
+**      UX_(Init)         U2_Init, U2_INTERRUPT_MODE, ...
+**      UX_REG(RXREG)     U2RXREG
+**      UX_BIT(OERR)      _U2_OERR, see uart.h
+**      UX_IRQ(RXIF)      _U2RXIF
+**
+**  Do not add this file to the project source files.
+**  
+*/
+#ifndef UART_N
+#error UART_N must be set before uart_instance.h is included.
+#endif
+
+/*
+** Check the BRG values picked by the baud rate solver in uart.h
+*/
+#if UX_(BRGREG) > 65535
+#error Cannot set up the UART for the FCYC and BAUDRATE. Correct values in init.h and uart.h files.
+#endif
+
+#if UX_(BAUD_ERROR) > UART_BAUD_ERROR_MAX
+#error UART baudrate error greater than UART_BAUD_ERROR_MAX for the FCYC and Ux_BAUD. Correct values in init.h and uart.h files.
+#endif
+
+/*
+** UxBRG range Ux_AutoBaud accepts, a faster baud rate has a
+** smaller BRG value
+*/
+#define UX_AUTOBAUD_BRG_MIN UART_BRG(UART_AUTOBAUD_MAX, UX_(BRGH_SCALE))
+#define UX_AUTOBAUD_BRG_MAX UART_BRG(UART_AUTOBAUD_MIN, UX_(BRGH_SCALE))
+
+#if UX_AUTOBAUD_BRG_MIN > 65535
+#error UART_AUTOBAUD_MAX is too fast for the FCYC. Correct values in init.h and uart.h files.
+#endif
+
+#if UX_AUTOBAUD_BRG_MAX > 65535
+#error UART_AUTOBAUD_MIN is too slow for the FCYC. Correct values in init.h and uart.h files.
+#endif
+
+/*
+** Ring buffers used in interrupt mode
+**
+** The head index is only written by the producer and the tail
+** index only by the consumer so no interrupt masking is needed.
+** The indexes run free and are masked on access, this lets a
+** full buffer be told from an empty one without a counter.
+*/
+#if UX_(INTERRUPT_MODE)
+#if (UX_(TXBUF_SIZE) & (UX_(TXBUF_SIZE)-1)) || (UX_(RXBUF_SIZE) & (UX_(RXBUF_SIZE)-1))
+#error UART buffer sizes must be a power of two. Correct values in uart.h file.
+#endif
+static volatile char UX_(TxBuf)[UX_(TXBUF_SIZE)];
+static volatile char UX_(RxBuf)[UX_(RXBUF_SIZE)];
+static volatile unsigned short UX_(TxHead);
+static volatile unsigned short UX_(TxTail);
+static volatile unsigned short UX_(RxHead);
+static volatile unsigned short UX_(RxTail);
+
+/*
+** Transmit descriptors, see Ux_QueueConst
+**
+** The ISR sends the descriptors in order once the TX ring
+** buffer is empty. While any are queued Ux_Write takes nothing
+** so bytes cannot overtake data queued before them.
+*/
+#if (UX_(TXDESC_COUNT) & (UX_(TXDESC_COUNT)-1))
+#error UART descriptor count must be a power of two. Correct values in uart.h file.
+#endif
+static volatile UartTxDesc_t UX_(TxDesc)[UX_(TXDESC_COUNT)];
+static volatile unsigned char UX_(DescHead);
+static volatile unsigned char UX_(DescTail);
+
+#define UX_TX_DESC_BUSY() (UX_(DescHead) != UX_(DescTail))
+
+/*
+** The TX interrupt is raised when a character moves out of the
+** FIFO. Once the ISR has found nothing to send and the FIFO has
+** run empty no more come, so setting the flag is what starts the
+** ISR again when new data is queued.
+*/
+#define UX_TX_RESUME() do { UX_IRQ(TXIE) = 1; UX_IRQ(TXIF) = 1; } while (0)
+
+/*
+** With flow control the RX interrupt turns itself off when the
+** ring buffer is full. Turn it back on once a byte is taken out,
+** setting the flag makes it drain what is waiting in the FIFO.
+*/
+#if UX_(FLOW_CONTROL)
+#define UX_RX_RESUME() do { if (UX_IRQ(RXIE) == 0) { UX_IRQ(RXIE) = 1; UX_IRQ(RXIF) = 1; } } while (0)
+#else
+#define UX_RX_RESUME()
+#endif
+#endif
+
+/*
+** Line error counters
+**
+** FERR and PERR describe the character at the top of the RX
+** FIFO so they are counted before UxRXREG is read. Counters
+** wrap at 65535, read them with Ux_GetStats.
+*/
+static volatile UartStats_t UX_(Stats);
+
+#define UX_COUNT_ERRORS() do { if (UX_BIT(FERR)) UX_(Stats).Framing++; if (UX_BIT(PERR)) UX_(Stats).Parity++; } while (0)
+
+/*
+** Idle left before Ux_WaitForData may Sleep, and the RX head it
+** last saw to tell when data came in, see Ux_WaitForData
+*/
+#if UX_(RX_SLEEP)
+static unsigned char UX_(WakeIdle);
+#if UX_(INTERRUPT_MODE)
+static unsigned short UX_(WakeHead);
+#endif
+#endif
+
+/*
+** Declare private functions
+*/
+static void UX_(Overrun)( void );
+
+/*
+** Function: Ux_Init
+**
+** Precondition: None.
+**
+** Overview: Setup the UART module.
+**
+** Input: None.
+**
+** Output: None.
+**
+*/
+void
+UX_(Init)(
+    void
+    )
+{
+    /* Disable interrupts */
+    UX_IRQ(TXIE) = 0;
+    UX_IRQ(RXIE) = 0;
+    UX_IRQ(ERIE) = 0;
+    UX_IRQ(RXIP) = 0b100;
+    UX_IRQ(TXIP) = 0b100;
+    UX_IRQ(ERIP) = 0b100;
+    /* Turn off UART */
+    UX_REG(MODE) = 0;
+    UX_REG(STA) = 0;
+    /* Setup default GPIO states for UART pins */
+    UX_(TXD) = 1;
+    UX_(TXD_DIR) = 0;
+    UX_(RXD_DIR) = 1;
+    /* Initialize the UART */
+    UX_REG(BRG) = UX_(BRGREG);
+    UX_BIT(BRGH) = UX_(BRGH_VALUE);
+#if UX_(FLOW_CONTROL)
+    UX_BIT(RTSMD) = 0;     /* RTS is flow control, not simplex */
+    UX_BIT(UEN) = 0b10;    /* UxTX, UxRX, UxCTS and UxRTS pins used */
+#endif
+    UX_BIT(UARTEN) = 1;
+    UX_BIT(UTXEN)  = 1;
+    UX_IRQ(RXIF) = 0;        /* reset RX flag */
+#if UX_(INTERRUPT_MODE)
+    UX_(TxHead) = 0;
+    UX_(TxTail) = 0;
+    UX_(DescHead) = 0;
+    UX_(DescTail) = 0;
+    UX_(RxHead) = 0;
+    UX_(RxTail) = 0;
+    UX_BIT(UTXISEL1) = 0;   /* TX interrupt when a slot opens in the FIFO */
+    UX_BIT(UTXISEL0) = 0;
+    UX_BIT(URXISEL) = 0b00; /* RX interrupt on each character received */
+    UX_IRQ(RXIE) = 1;        /* TX interrupt is enabled when data is queued */
+#endif
+}
+
+/*
+** Function: Ux_PutChar
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Wait for room in the UART transmit FIFO and send a byte.
+**
+** Input: Byte to be sent.
+**
+** Output: None.
+**
+*/
+void  
+UX_(PutChar)(
+    char Ch
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    while(UX_(TryPutChar)(Ch) == 0);
+#else
+    // wait for room in the TX FIFO
+    while(UX_BIT(UTXBF) != 0);
+    UX_REG(TXREG) = Ch;
+#endif
+}
+
+/*
+** Function: Ux_TryPutChar
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Send a byte if there is room for it, do not wait.
+**
+** Input: Byte to be sent.
+**
+** Output: Zero if the byte could not be queued.
+**
+*/
+char
+UX_(TryPutChar)(
+    char Ch
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    unsigned short Head;
+
+    Head = UX_(TxHead);
+    if (((unsigned short)(Head - UX_(TxTail)) >= UX_(TXBUF_SIZE)) || UX_TX_DESC_BUSY())
+        return 0;
+    UX_(TxBuf)[Head & (UX_(TXBUF_SIZE)-1)] = Ch;
+    UX_(TxHead) = Head + 1;
+    UX_TX_RESUME();          /* ISR moves the data to the FIFO */
+    return 1;
+#else
+    if (UX_BIT(UTXBF) != 0)
+        return 0;
+    UX_REG(TXREG) = Ch;
+    return 1;
+#endif
+}
+
+/*
+** Function: Ux_HasData
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Check if there's a new byte in UART reception buffer.
+**
+** Input: None.
+**
+** Output: Zero if there's no new data received.
+**
+*/
+char 
+UX_(HasData)(
+    void
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    if (UX_(RxHead) != UX_(RxTail))
+        return 1;
+    return 0;
+#else
+    if (UX_BIT(OERR) != 0)
+    {
+        UX_(Overrun)();
+    }
+    if(UX_IRQ(RXIF) == 1)
+        return 1;
+    return 0;
+#endif
+}
+
+/*
+** Function: Ux_GetChar
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Wait for a byte.
+**
+** Input: None.
+**
+** Output: Byte received.
+**
+**
+*/
+char 
+UX_(GetChar)(
+    void
+    )
+{
+    char Temp;
+
+#if UX_(INTERRUPT_MODE)
+    while(UX_(TryGetChar)(&Temp) == 0);
+#else
+    if (UX_BIT(OERR) != 0)
+    {
+        UX_(Overrun)();
+    }
+    while(UX_IRQ(RXIF) == 0);
+    UX_COUNT_ERRORS();
+    Temp = UX_REG(RXREG);
+    if (UX_BIT(URXDA) == 0)
+    {
+        UX_IRQ(RXIF) = 0;
+    }
+#endif
+    return Temp;
+}
+
+/*
+** Function: Ux_TryGetChar
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Get a byte if one has been received, do not wait.
+**
+** Input: Pointer to where the byte is stored.
+**
+** Output: Zero if there was no byte to get.
+**
+*/
+char
+UX_(TryGetChar)(
+    char *pCh
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    unsigned short Tail;
+
+    Tail = UX_(RxTail);
+    if (Tail == UX_(RxHead))
+        return 0;
+    *pCh = UX_(RxBuf)[Tail & (UX_(RXBUF_SIZE)-1)];
+    UX_(RxTail) = Tail + 1;
+    UX_RX_RESUME();
+    return 1;
+#else
+    if (UX_(HasData)() == 0)
+        return 0;
+    *pCh = UX_(GetChar)();
+    return 1;
+#endif
+}
+
+/*
+** Function: Ux_Write
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Send as many bytes from a buffer as the UART can
+** take right now. Polled mode fills the hardware TX FIFO,
+** interrupt mode fills the TX ring buffer.
+**
+** Input: Pointer to the bytes to send.
+**        Number of bytes to send.
+**
+** Output: Number of bytes taken, may be less than asked for.
+**
+*/
+size_t
+UX_(Write)(
+    const char *pBuf,
+    size_t Len
+    )
+{
+    size_t Count;
+#if UX_(INTERRUPT_MODE)
+    unsigned short Head;
+    unsigned short Free;
+
+    Head = UX_(TxHead);
+    Free = UX_(TXBUF_SIZE) - (unsigned short)(Head - UX_(TxTail));
+    if (UX_TX_DESC_BUSY())
+        Free = 0;
+    if (Len > Free)
+        Len = Free;
+    for (Count = 0; Count < Len; Count++)
+    {
+        UX_(TxBuf)[Head & (UX_(TXBUF_SIZE)-1)] = pBuf[Count];
+        Head++;
+    }
+    if (Count)
+    {
+        UX_(TxHead) = Head;
+        UX_TX_RESUME();      /* ISR moves the data to the FIFO */
+    }
+#else
+    for (Count = 0; (Count < Len) && (UX_BIT(UTXBF) == 0); Count++)
+    {
+        UX_REG(TXREG) = pBuf[Count];
+    }
+#endif
+    return Count;
+}
+
+/*
+** Function: Ux_Read
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Get every byte the UART has received, up to the
+** size of the buffer. When no data is waiting the receiver is
+** polled Timeout more times before giving up.
+**
+** Input: Pointer to where the bytes are stored.
+**        Size of the buffer.
+**        Number of empty polls to wait for more data,
+**        zero returns only data already received.
+**
+** Output: Number of bytes stored, may be less than asked for.
+**
+*/
+size_t
+UX_(Read)(
+    char *pBuf,
+    size_t Max,
+    unsigned int Timeout
+    )
+{
+    size_t Count;
+    unsigned int Wait;
+#if UX_(INTERRUPT_MODE)
+    unsigned short Tail;
+
+    Count = 0;
+    Wait = Timeout;
+    Tail = UX_(RxTail);
+    while (Count < Max)
+    {
+        if (Tail != UX_(RxHead))
+        {
+            pBuf[Count++] = UX_(RxBuf)[Tail & (UX_(RXBUF_SIZE)-1)];
+            Tail++;
+            UX_(RxTail) = Tail;
+            UX_RX_RESUME();
+            Wait = Timeout;
+        }
+        else if (Wait)
+        {
+            Wait--;
+        }
+        else break;
+    }
+#else
+    Count = 0;
+    Wait = Timeout;
+    while (Count < Max)
+    {
+        if (UX_BIT(URXDA) != 0)
+        {
+            UX_COUNT_ERRORS();
+            pBuf[Count++] = UX_REG(RXREG);
+            Wait = Timeout;
+        }
+        else if (UX_BIT(OERR) != 0)
+        {
+            UX_(Stats).Overrun++;
+            UX_BIT(OERR) = 0;   /* FIFO is empty, restart the receiver */
+        }
+        else if (Wait)
+        {
+            Wait--;
+        }
+        else break;
+    }
+    if (UX_BIT(URXDA) == 0)
+    {
+        UX_IRQ(RXIF) = 0;
+    }
+#endif
+    return Count;
+}
+
+/*
+** Function: Ux_AutoBaud
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Measure the baud rate of the other end from a 0x55
+** sync byte. The ABAUD hardware times the sync byte and loads
+** UxBRG. When the measured BRG is in the range set by
+** UART_AUTOBAUD_MIN and UART_AUTOBAUD_MAX the UART keeps it,
+** otherwise or on timeout the compiled Ux_BAUD is put back.
+** Bytes already received are discarded.
+**
+** Input: Number of polls to wait for the sync byte.
+**
+** Output: Zero if the compiled baud rate is in use.
+**
+*/
+char
+UX_(AutoBaud)(
+    unsigned long Timeout
+    )
+{
+    char Temp;
+    char Found;
+    unsigned short Brg;
+#if UX_(INTERRUPT_MODE)
+    char RxIE;
+
+    RxIE = UX_IRQ(RXIE);
+    UX_IRQ(RXIE) = 0;        /* keep the sync byte out of the ring buffer */
+#endif
+    while (UX_BIT(URXDA) != 0)
+    {
+        Temp = UX_REG(RXREG);
+    }
+    UX_BIT(OERR) = 0;
+    UX_BIT(ABAUD) = 1;
+    while (UX_BIT(ABAUD) != 0 && Timeout != 0)
+    {
+        Timeout--;
+    }
+    Brg = UX_REG(BRG);
+    if ((UX_BIT(ABAUD) != 0) || (Brg < UX_AUTOBAUD_BRG_MIN) || (Brg > UX_AUTOBAUD_BRG_MAX))
+    {
+        UX_BIT(ABAUD) = 0;
+        UX_REG(BRG) = UX_(BRGREG);
+        Found = 0;
+    }
+    else
+    {
+        Found = 1;
+    }
+    while (UX_BIT(URXDA) != 0)
+    {
+        Temp = UX_REG(RXREG);
+    }
+    UX_BIT(OERR) = 0;
+    UX_IRQ(RXIF) = 0;
+#if UX_(INTERRUPT_MODE)
+    UX_IRQ(RXIE) = RxIE;
+#endif
+    return Found;
+}
+
+/*
+** Function: Ux_GetBaud
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Work out the baud rate the UART runs at now, this
+** changes when Ux_AutoBaud has measured a new rate.
+**
+** Input: None.
+**
+** Output: Baud rate in bits per second.
+**
+*/
+unsigned long
+UX_(GetBaud)(
+    void
+    )
+{
+    return FCYC / (UX_(BRGH_SCALE) * ((unsigned long)UX_REG(BRG) + 1UL));
+}
+
+/*
+** Function: Ux_TxFree
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Find how many bytes Ux_Write can take right now
+** without waiting.
+**
+** Input: None.
+**
+** Output: Free space in the TX ring buffer, in polled mode
+** one when the TX FIFO has room.
+**
+*/
+size_t
+UX_(TxFree)(
+    void
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    if (UX_TX_DESC_BUSY())
+        return 0;
+    return UX_(TXBUF_SIZE) - (unsigned short)(UX_(TxHead) - UX_(TxTail));
+#else
+    if (UX_BIT(UTXBF) != 0)
+        return 0;
+    return 1;
+#endif
+}
+
+/*
+** Function: Ux_WaitForData
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Stop the core until the UART may have data. With
+** Ux_RX_SLEEP the part sleeps and the UART wakes it on the
+** falling edge of the next start bit. The character that wakes
+** the part is not received so the host should lead with 0x00
+** or a break. Idle is used instead while the UART is still
+** sending or the wake character has not finished, the UART
+** keeps running in Idle and no characters are lost. After a wake,
+** and after data has come in, Idle is used Ux_WAKE_IDLE times
+** before the part may Sleep again. Otherwise it would Sleep as
+** soon as the wake character ended, and the start bit of each
+** character after it would wake the part and be lost.
+**
+** Input: None.
+**
+** Output: None, returns after any interrupt so the caller
+** must check for data again.
+**
+*/
+void
+UX_(WaitForData)(
+    void
+    )
+{
+    /*
+     * DISI holds off the interrupts that wake the core until the
+     * checks are done, they are taken after __builtin_disi(0).
+     * SRbits.IPL cannot be used, it is read only with NSTDIS set.
+     * DISICNT does not count while the core is stopped.
+     */
+    __builtin_disi(0x3FFF);
+#if !UX_(INTERRUPT_MODE)
+    UX_IRQ(RXIE) = 1;        /* RXIF must be enabled to wake the core */
+#endif
+#if UX_(RX_SLEEP) && UX_(INTERRUPT_MODE)
+    if (UX_(RxHead) != UX_(WakeHead))
+    {
+        UX_(WakeHead) = UX_(RxHead);
+        UX_(WakeIdle) = UX_(WAKE_IDLE);  /* data came in, more may follow */
+    }
+#endif
+    if (UX_(HasData)() == 0)
+    {
+#if UX_(RX_SLEEP)
+#if UX_(INTERRUPT_MODE)
+        if ((UX_(WakeIdle) == 0) && (UX_BIT(WAKE) == 0) && (UX_(TxHead) == UX_(TxTail)) && !UX_TX_DESC_BUSY() && (UX_BIT(TRMT) != 0))
+#else
+        if ((UX_(WakeIdle) == 0) && (UX_BIT(WAKE) == 0) && (UX_BIT(TRMT) != 0))
+#endif
+        {
+            UX_BIT(WAKE) = 1;
+            UX_(WakeIdle) = UX_(WAKE_IDLE);  /* the rest of the burst comes in Idle */
+            Sleep();
+        }
+        else
+        {
+            if (UX_(WakeIdle) != 0)
+                UX_(WakeIdle)--;
+            Idle();
+        }
+#else
+        Idle();
+#endif
+    }
+#if !UX_(INTERRUPT_MODE)
+    UX_IRQ(RXIE) = 0;
+    if (UX_BIT(URXDA) == 0)
+    {
+        UX_IRQ(RXIF) = 0;    /* wake event, no character yet */
+    }
+#if UX_(RX_SLEEP)
+    else
+    {
+        UX_(WakeIdle) = UX_(WAKE_IDLE);  /* data came in, more may follow */
+    }
+#endif
+#endif
+    __builtin_disi(0x0000);
+}
+
+/*
+** Function: Ux_GetStats
+**
+** Precondition: None.
+**
+** Overview: Take a copy of the UART line error counters and
+** optionally start them again from zero.
+**
+** Input: Pointer to where the counters are copied.
+**        Non-zero to clear the counters after the copy.
+**
+** Output: None.
+**
+*/
+void
+UX_(GetStats)(
+    UartStats_t *pStats,
+    char Reset
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    char RxIE;
+
+    RxIE = UX_IRQ(RXIE);
+    UX_IRQ(RXIE) = 0;        /* the RX ISR updates the counters */
+    Generic_GetStats(&UX_(Stats), pStats, Reset);
+    UX_IRQ(RXIE) = RxIE;
+#else
+    Generic_GetStats(&UX_(Stats), pStats, Reset);
+#endif
+}
+
+/*
+** Polled mode receive overrun
+**
+** The FIFO holds characters received before the overrun but
+** clearing OERR throws them away. Read them out so they are
+** counted as dropped then restart the receiver. RXIF stays set
+** from those characters, clear it or the next Ux_GetChar reads
+** the empty FIFO.
+*/
+static void
+UX_(Overrun)(
+    void
+    )
+{
+    char Temp;
+
+    UX_(Stats).Overrun++;
+    while (UX_BIT(URXDA) != 0)
+    {
+        Temp = UX_REG(RXREG);
+        UX_(Stats).Dropped++;
+    }
+    UX_IRQ(RXIF) = 0;
+    UX_BIT(OERR) = 0;
+}
+
+#if UX_(INTERRUPT_MODE)
+/*
+** UART transmit interrupt
+**
+** Move queued bytes into the hardware FIFO until it is full
+** or there is nothing left to send, then turn the interrupt
+** off. The ring buffer goes first, then the descriptors. Data
+** a descriptor points at is read where it is, for constants
+** that is program memory through the PSV window. PSVPAG is set
+** once at startup and the whole 16K of flash is one PSV page
+** so the ISR does not need auto_psv.
+*/
+void __attribute__((interrupt,no_auto_psv)) UX_IRQ(TXInterrupt)(void)
+{
+    unsigned short Tail;
+    unsigned char DescTail;
+    volatile UartTxDesc_t *pDesc;
+
+    UX_IRQ(TXIF) = 0;
+    Tail = UX_(TxTail);
+    DescTail = UX_(DescTail);
+    while (UX_BIT(UTXBF) == 0)
+    {
+        if (Tail != UX_(TxHead))
+        {
+            UX_REG(TXREG) = UX_(TxBuf)[Tail & (UX_(TXBUF_SIZE)-1)];
+            Tail++;
+        }
+        else if (DescTail != UX_(DescHead))
+        {
+            pDesc = &UX_(TxDesc)[DescTail & (UX_(TXDESC_COUNT)-1)];
+            UX_REG(TXREG) = *pDesc->pData++;
+            if (--pDesc->Len == 0)
+                DescTail++;
+        }
+        else
+        {
+            UX_IRQ(TXIE) = 0;
+            break;
+        }
+    }
+    UX_(TxTail) = Tail;
+    UX_(DescTail) = DescTail;
+}
+
+/*
+** UART receive interrupt
+**
+** Drain the hardware FIFO into the ring buffer. Bytes that
+** arrive when the ring buffer is full are discarded, or with
+** flow control left in the FIFO until there is room.
+*/
+void __attribute__((interrupt,no_auto_psv)) UX_IRQ(RXInterrupt)(void)
+{
+    unsigned short Head;
+    unsigned short Used;
+    char Ch;
+
+    UX_IRQ(RXIF) = 0;
+    Head = UX_(RxHead);
+    while (UX_BIT(URXDA) != 0)
+    {
+#if UX_(FLOW_CONTROL)
+        if ((unsigned short)(Head - UX_(RxTail)) >= UX_(RXBUF_SIZE))
+        {
+            UX_IRQ(RXIE) = 0;   /* leave the rest in the FIFO, RTS holds off the sender */
+            break;
+        }
+#endif
+        UX_COUNT_ERRORS();
+        Ch = UX_REG(RXREG);
+        Used = (unsigned short)(Head - UX_(RxTail));
+        if (Used < UX_(RXBUF_SIZE))
+        {
+            UX_(RxBuf)[Head & (UX_(RXBUF_SIZE)-1)] = Ch;
+            Head++;
+            if (Used >= UX_(Stats).RxHighWater)
+                UX_(Stats).RxHighWater = Used + 1;
+        }
+        else
+        {
+            UX_(Stats).Dropped++;
+        }
+    }
+    UX_(RxHead) = Head;
+    if (UX_BIT(OERR) != 0)
+    {
+        UX_(Stats).Overrun++;
+        UX_BIT(OERR) = 0;   /* FIFO is empty, restart the receiver */
+    }
+}
+#endif
+
+
+/*
+** Function: Ux_QueueConst
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Send data in place without copying it. In interrupt
+** mode a descriptor holding the pointer and length is queued
+** and the TX ISR reads the bytes straight from where they are.
+** The data must not change until it has been sent, so this is
+** meant for constants, which XC16 keeps in program memory. In
+** polled mode the data is sent before returning.
+**
+** Input: Pointer to the data.
+**        Number of bytes.
+**
+** Output: Zero if the descriptor queue is full.
+**
+*/
+char
+UX_(QueueConst)(
+    const char *pData,
+    size_t Len
+    )
+{
+#if UX_(INTERRUPT_MODE)
+    unsigned char Head;
+    volatile UartTxDesc_t *pDesc;
+
+    if (Len == 0)
+        return 1;
+    Head = UX_(DescHead);
+    if ((unsigned char)(Head - UX_(DescTail)) >= UX_(TXDESC_COUNT))
+        return 0;
+    pDesc = &UX_(TxDesc)[Head & (UX_(TXDESC_COUNT)-1)];
+    pDesc->pData = pData;
+    pDesc->Len = Len;
+    UX_(DescHead) = Head + 1;
+    UX_TX_RESUME();          /* ISR sends the data */
+#else
+    UX_(PutBuffer)(pData, Len);
+#endif
+    return 1;
+}
+
+/*
+** Function: Ux_PutConst
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Wait for a free descriptor then queue data to be
+** sent in place, see Ux_QueueConst.
+**
+** Input: Pointer to the data.
+**        Number of bytes.
+**
+** Output: None.
+**
+*/
+void
+UX_(PutConst)(
+    const char *pData,
+    size_t Len
+    )
+{
+    while (UX_(QueueConst)(pData, Len) == 0);
+}
+
+/*
+** Function: Ux_PutConstList
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Queue a list of data blocks to be sent one after
+** the other in place, see Ux_QueueConst. The list itself is
+** copied so it can be on the stack.
+**
+** Input: Pointer to the first descriptor.
+**        Number of descriptors.
+**
+** Output: None.
+**
+*/
+void
+UX_(PutConstList)(
+    const UartTxDesc_t *pList,
+    unsigned char Count
+    )
+{
+    while (Count--)
+    {
+        UX_(PutConst)(pList->pData, pList->Len);
+        pList++;
+    }
+}
+
+/*
+** Formatted output functions
+**
+** Precondition: Ux_Init must be called before.
+**
+**  Ux_PutBuffer  - bytes already rendered, see format.c
+**  Ux_PutDec     - unsigned int as 5 decimal digits padded with spaces
+**  Ux_PutDecLong - unsigned long as 10 decimal digits padded with spaces
+**  Ux_PutHex     - unsigned char as 2 hexadecimal digits
+**  Ux_PutHexWord - unsigned short as 4 hexadecimal digits
+**  Ux_PutString  - ASCIIZ string
+**
+**  Each function renders its text into a small buffer first and
+**  hands it to Ux_Write in one piece rather than a character at
+**  a time. Decimal conversion does not use divide, see format.c.
+**  They wait until all bytes are taken by the UART.
+**
+*/
+void
+UX_(PutBuffer)(
+    const char *pBuf,
+    size_t Len
+    )
+{
+    size_t Count;
+
+    while (Len)
+    {
+        Count = UX_(Write)(pBuf, Len);
+        pBuf += Count;
+        Len -= Count;
+    }
+}
+
+void
+UX_(PutDec)(
+    unsigned int Dec
+    )
+{
+    char Buf[FMT_DEC16_DIGITS];
+
+    UX_(PutBuffer)(Buf, Fmt_Dec16(Buf, Dec, FMT_DEC16_DIGITS, 0));
+}
+
+void
+UX_(PutDecLong)(
+    unsigned long Dec
+    )
+{
+    char Buf[FMT_DEC32_DIGITS];
+
+    UX_(PutBuffer)(Buf, Fmt_Dec32(Buf, Dec, FMT_DEC32_DIGITS, 0));
+}
+
+void
+UX_(PutHex)(
+    unsigned char Hex
+    )
+{
+    char Buf[FMT_HEX_DIGITS];
+
+    UX_(PutBuffer)(Buf, Fmt_Hex(Buf, Hex));
+}
+
+void
+UX_(PutHexWord)(
+    unsigned short Hex
+    )
+{
+    char Buf[FMT_HEXWORD_DIGITS];
+
+    UX_(PutBuffer)(Buf, Fmt_HexWord(Buf, Hex));
+}
+
+void
+UX_(PutString)(
+    char *pBuf
+    )
+{
+    if (pBuf)
+    {
+        UX_(PutBuffer)(pBuf, strlen(pBuf));
+    }
+}
+
+/*
+** Function: Ux_PutFrame
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Send a payload as one COBS frame with CRC-16, see
+** frame.c for the frame layout.
+**
+** Input: Pointer to the payload.
+**        Number of payload bytes, at most FRAME_MAX_PAYLOAD.
+**
+** Output: Waits until the whole frame is taken by the UART.
+**
+*/
+void
+UX_(PutFrame)(
+    const unsigned char *pData,
+    unsigned char Len
+    )
+{
+    unsigned char Buf[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+
+    if (Len > FRAME_MAX_PAYLOAD)
+        return;
+    UX_(PutBuffer)((const char *)Buf, Frame_Encode(Buf, pData, Len));
+}
+
+/*
+** Function: Ux_GetFrame
+**
+** Precondition: Ux_Init must be called before.
+**
+** Overview: Feed received bytes to a frame decoder. Bytes are
+** read one at a time so those after the end of a frame stay in
+** the UART for the next call.
+**
+** Input: Pointer to the frame decoder.
+**
+** Output: FRAME_READY when a good frame has ended, the payload
+**         is then in the decoder. FRAME_ERROR when a frame was
+**         dropped. FRAME_BUSY when every received byte has been
+**         taken and no frame has ended.
+**
+*/
+unsigned char
+UX_(GetFrame)(
+    FrameDecoder_t *pDec
+    )
+{
+    char Ch;
+    unsigned char Result;
+
+    while (UX_(Read)(&Ch, 1, 0) != 0)
+    {
+        Result = Frame_Decode(pDec, (unsigned char)Ch);
+        if (Result != FRAME_BUSY)
+            return Result;
+    }
+    return FRAME_BUSY;
+}
+
+#undef UX_AUTOBAUD_BRG_MIN
+#undef UX_AUTOBAUD_BRG_MAX
+#undef UX_RX_RESUME
+#undef UX_TX_RESUME
+#undef UX_COUNT_ERRORS
+#undef UX_TX_DESC_BUSY
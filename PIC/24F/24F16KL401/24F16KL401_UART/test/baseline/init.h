@@ -0,0 +1,20 @@
+/* 
+**     file: init.h
+**   Target: PIC24F16KL401
+**      IDE: MPLABX v3.35
+** Compiler: XC16 v1.26
+**  
+** Description:
+**  
+**      
+*/
+#ifndef INIT_H
+#define INIT_H
+
+/*
+ * Define constants for how we will configure the clock
+ */
+#define FOSC (2000000UL)
+#define FCYC (FOSC/2UL)
+
+#endif
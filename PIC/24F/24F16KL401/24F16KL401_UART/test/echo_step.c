@@ -0,0 +1,33 @@
+/*
+ * One echo step on each UART, for instance_bench
+ *
+ * Built with the project driver or with the baseline polled one in
+ * baseline/, the calls are the same for both. Declared here, not
+ * from uart.h, so the same file builds against either.
+ */
+void U1_Init( void );
+void U1_PutChar( char Ch );
+char U1_HasData( void );
+char U1_GetChar( void );
+void U2_Init( void );
+void U2_PutChar( char Ch );
+char U2_HasData( void );
+char U2_GetChar( void );
+
+void Echo_Init( void )
+{
+    U1_Init();
+    U2_Init();
+}
+
+void Echo_U1( void )
+{
+    if(U1_HasData())
+        U1_PutChar(U1_GetChar());
+}
+
+void Echo_U2( void )
+{
+    if(U2_HasData())
+        U2_PutChar(U2_GetChar());
+}
@@ -0,0 +1,124 @@
+/*
+ * Decimal conversion cost, format.c against the old ladder
+ *
+ * format.c and generic_ref.c, the Generic_PutDec subtract ladder
+ * format.c took over from, are built with
+ * -fsanitize-coverage=trace-pc. Here each basic block is counted
+ * and costs MODEL_BB_CYCLES, as on the model. Both render the
+ * same ten character field, the ladder sends each character to a
+ * PutChar that only stores it, so the UART time is not counted
+ * for either, nor the ten calls the ladder made through the
+ * PutChar pointer.
+ *
+ * For each set of values the mean, least and most cycles of one
+ * conversion are listed. The format.c text must be what snprintf
+ * gives. The ladder copied its remainder to 16 bits after the
+ * first step of the 10000s digit, when up to 79999 can be left,
+ * the values it got wrong that way are counted.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "format.h"
+#include "model.h"
+
+void Ref_PutDec( void (*Ux_PutChar)(char), unsigned long Dec32 );
+
+static unsigned long blocks;
+
+void __sanitizer_cov_trace_pc(void)
+{
+    blocks++;
+}
+
+static char refBuf[16];
+static unsigned refLen;
+
+static void RefPutChar(char Ch)
+{
+    if(refLen < sizeof(refBuf))
+        refBuf[refLen++] = Ch;
+}
+
+typedef struct {
+    unsigned long long sum;
+    unsigned long count, least, most;
+} Cost_t;
+
+static void Add(Cost_t *pCost, unsigned long Blocks)
+{
+    unsigned long cycles = Blocks * MODEL_BB_CYCLES;
+
+    if(!pCost->count || (cycles < pCost->least))
+        pCost->least = cycles;
+    if(cycles > pCost->most)
+        pCost->most = cycles;
+    pCost->sum += cycles;
+    pCost->count++;
+}
+
+static int Run(const char *Name, const unsigned long *pValue, unsigned long Count, int Short)
+{
+    Cost_t ref = { 0 }, fmt = { 0 };
+    char buf[16];
+    char want[16];
+    unsigned long i, start, wrong = 0;
+    unsigned n;
+    int bad = 0;
+
+    for(i = 0; i < Count; i++)
+    {
+        refLen = 0;
+        start = blocks;
+        Ref_PutDec(RefPutChar, pValue[i]);
+        Add(&ref, blocks - start);
+
+        start = blocks;
+        if(Short)
+            n = Fmt_Dec16(buf, (unsigned short)pValue[i], FMT_DEC32_DIGITS, 0);
+        else
+            n = Fmt_Dec32(buf, pValue[i], FMT_DEC32_DIGITS, 0);
+        Add(&fmt, blocks - start);
+
+        snprintf(want, sizeof(want), "%10lu", Short ? (unsigned short)pValue[i] : pValue[i]);
+        if(!bad && ((n != strlen(want)) || memcmp(buf, want, n)))
+        {
+            printf("FAIL: %lu is \"%.*s\"\n", pValue[i], n, buf);
+            bad = 1;
+        }
+        if((refLen != strlen(want)) || memcmp(refBuf, want, refLen))
+            wrong++;
+    }
+    printf("%-20s Generic_PutDec %3llu cycles (%lu to %lu), %s %3llu cycles (%lu to %lu)",
+        Name, ref.sum / ref.count, ref.least, ref.most,
+        Short ? "Fmt_Dec16" : "Fmt_Dec32", fmt.sum / fmt.count, fmt.least, fmt.most);
+    if(wrong)
+        printf(", Generic_PutDec wrong for %lu", wrong);
+    printf("\n");
+    return bad;
+}
+
+#define VALUES 1000000UL
+
+int main(void)
+{
+    static unsigned long value[VALUES];
+    unsigned long i, seed;
+    int bad = 0;
+
+    printf("decimal to a 10 character field, %u cycles a basic block\n", MODEL_BB_CYCLES);
+    for(i = 0; i < 1000; i++)
+        value[i] = i;
+    bad |= Run("0 to 999", value, 1000, 0);
+    bad |= Run("0 to 999", value, 1000, 1);
+    for(i = 0; i < 65536UL; i++)
+        value[i] = i;
+    bad |= Run("every 16-bit value", value, 65536UL, 0);
+    bad |= Run("every 16-bit value", value, 65536UL, 1);
+    for(seed = 1, i = 0; i < VALUES; i++)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+        value[i] = seed;
+    }
+    bad |= Run("10^6 random 32-bit", value, VALUES, 0);
+    return bad;
+}
@@ -0,0 +1,348 @@
+/*
+ * The Generic_ print helpers as uart.c had them before format.c,
+ * copied as they were apart from the names so fmt_bench and
+ * record_bench can compare the two. Each character goes through
+ * the PutChar pointer, Ref_PutDec always sends ten characters,
+ * leading zeros as spaces.
+ */
+void Ref_PutDec( void (*Ux_PutChar)(char), unsigned long Dec32 );
+void Ref_PutHex( void (*Ux_PutChar)(char), unsigned char Hex );
+void Ref_PutHexWord( void (*Ux_PutChar)(char), unsigned short Hex );
+void Ref_PutString( void (*Ux_PutChar)(char), char *pBuf );
+
+
+/*
+** Generic print decimal to UART
+**
+** The UART must be initialized before this function is called.
+**
+** Input: Pointer to PutChar function.
+**        unsigned int binary value
+**
+** Output: Up to 5 decimal digits sent to UART
+**
+** Note: This function does not use divide to convert
+**       from binary to decimal.
+*/
+void
+Ref_PutDec(
+    void (*Ux_PutChar)(char),
+    unsigned long Dec32
+    )
+{
+    unsigned short Dec16;
+    unsigned char Digit;
+    unsigned char ZeroFlag;
+
+    if (Ux_PutChar)
+    {
+        ZeroFlag = 1;
+    
+        Digit = '0'; 
+        if (Dec32 >= 4000000000UL)
+        {
+            Digit += 4;
+            Dec32 -= 4000000000UL;
+        }
+        if (Dec32 >= 2000000000UL)
+        {
+            Digit += 2;
+            Dec32 -= 2000000000UL;
+        }
+        if (Dec32 >= 1000000000UL)
+        {
+            Digit += 1;
+            Dec32 -= 1000000000UL;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+
+        Digit = '0'; 
+        if (Dec32 >= 800000000UL)
+        {
+            Digit += 8;
+            Dec32 -= 800000000UL;
+        }
+        if (Dec32 >= 400000000UL)
+        {
+            Digit += 4;
+            Dec32 -= 400000000UL;
+        }
+        if (Dec32 >= 200000000UL)
+        {
+            Digit += 2;
+            Dec32 -= 200000000UL;
+        }
+        if (Dec32 >= 100000000UL)
+        {
+            Digit += 1;
+            Dec32 -= 100000000UL;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+
+        Digit = '0';
+        if (Dec32 >= 80000000UL)
+        {
+            Digit += 8;
+            Dec32 -= 80000000UL;
+        }
+        if (Dec32 >= 40000000UL)
+        {
+            Digit += 4;
+            Dec32 -= 40000000UL;
+        }
+        if (Dec32 >= 20000000UL)
+        {
+            Digit += 2;
+            Dec32 -= 20000000UL;
+        }
+        if (Dec32 >= 10000000UL)
+        {
+            Digit += 1;
+            Dec32 -= 10000000UL;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+
+        Digit = '0';
+        if (Dec32 >= 8000000UL)
+        {
+            Digit += 8;
+            Dec32 -= 8000000UL;
+        }
+        if (Dec32 >= 4000000UL)
+        {
+            Digit += 4;
+            Dec32 -= 4000000UL;
+        }
+        if (Dec32 >= 2000000UL)
+        {
+            Digit += 2;
+            Dec32 -= 2000000UL;
+        }
+        if (Dec32 >= 1000000UL)
+        {
+            Digit += 1;
+            Dec32 -= 1000000UL;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+
+        Digit = '0';
+        if (Dec32 >= 800000UL)
+        {
+            Digit += 8;
+            Dec32 -= 800000UL;
+        }
+        if (Dec32 >= 400000UL)
+        {
+            Digit += 4;
+            Dec32 -= 400000UL;
+        }
+        if (Dec32 >= 200000UL)
+        {
+            Digit += 2;
+            Dec32 -= 200000UL;
+        }
+        if (Dec32 >= 100000UL)
+        {
+            Digit += 1;
+            Dec32 -= 100000UL;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+
+        Digit = '0';
+        if (Dec32 >= 80000UL)
+        {
+            Digit += 8;
+            Dec32 -= 80000UL;
+        }
+        Dec16 = Dec32;
+        if (Dec16 >= 40000)
+        {
+            Digit += 4;
+            Dec16 -= 40000;
+        }
+        if (Dec16 >= 20000)
+        {
+            Digit += 2;
+            Dec16 -= 20000;
+        }
+        if (Dec16 >= 10000)
+        {
+            Digit += 1;
+            Dec16 -= 10000;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+    
+        Digit = '0';
+        if (Dec16 >= 8000)
+        {
+            Digit += 8;
+            Dec16 -= 8000;
+        }
+        if (Dec16 >= 4000)
+        {
+            Digit += 4;
+            Dec16 -= 4000;
+        }
+        if (Dec16 >= 2000)
+        {
+            Digit += 2;
+            Dec16 -= 2000;
+        }
+        if (Dec16 >= 1000)
+        {
+            Digit += 1;
+            Dec16 -= 1000;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+     
+        Digit = '0';
+        if (Dec16 >= 800)
+        {
+            Digit += 8;
+            Dec16 -= 800;
+        }
+        if (Dec16 >= 400)
+        {
+            Digit += 4;
+            Dec16 -= 400;
+        }
+        if (Dec16 >= 200)
+        {
+            Digit += 2;
+            Dec16 -= 200;
+        }
+        if (Dec16 >= 100)
+        {
+            Digit += 1;
+            Dec16 -= 100;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+        
+        Digit = '0';
+        if (Dec16 >= 80)
+        {
+            Digit += 8;
+            Dec16 -= 80;
+        }
+        if (Dec16 >= 40)
+        {
+            Digit += 4;
+            Dec16 -= 40;
+        }
+        if (Dec16 >= 20)
+        {
+            Digit += 2;
+            Dec16 -= 20;
+        }
+        if (Dec16 >= 10)
+        {
+            Digit += 1;
+            Dec16 -= 10;
+        }
+        if (('0' != Digit) || (0 == ZeroFlag))
+        {
+            Ux_PutChar(Digit);
+            ZeroFlag = 0;
+        } else Ux_PutChar(' ');
+        
+        Ux_PutChar(Dec16+'0');
+    }
+}
+
+/*
+** Generic print hexadecimal to UART
+**
+** The UART must be initialized before this function is called.
+**
+** Input: Pointer to PutChar function.
+**        unsigned char binary value
+**
+** Output: 2 hexadecimal digits sent to UART
+**
+*/
+void
+Ref_PutHex(
+    void (*Ux_PutChar)(char),
+    unsigned char Hex
+    )
+{
+    static const char HexChar[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+    if (Ux_PutChar)
+    {
+        Ux_PutChar(HexChar[(Hex>>4) & 0x0F ]);
+        Ux_PutChar(HexChar[ Hex     & 0x0F ]);
+    }
+}
+
+void
+Ref_PutHexWord(
+    void (*Ux_PutChar)(char),
+    unsigned short Hex
+    )
+{
+    Ref_PutHex(Ux_PutChar,(unsigned char)(Hex>>8));
+    Ref_PutHex(Ux_PutChar,(unsigned char)Hex);
+}
+/*
+** Generic print string to UART
+**
+** The UART must be initialized before this function is called.
+**
+** Input: Pointer to PutChar function.
+**        Pointer to ASCIIZ string.
+**
+** Output: Null terminated ASCII string sent to UART
+**
+** Note: Pointers are validated but no check on string length.
+**
+*/
+void
+Ref_PutString(
+    void (*Ux_PutChar)(char),
+    char *pBuf
+    )
+{
+    unsigned char c;
+
+    if ((pBuf) && (Ux_PutChar))
+    {
+        c = *pBuf++;
+        while(c)
+        {
+            Ux_PutChar(c);
+            c = *pBuf++;
+        }
+    }
+}
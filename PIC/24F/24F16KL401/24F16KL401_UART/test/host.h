@@ -0,0 +1,17 @@
+/*
+ * Read first by each project source, see PICFLAGS in the Makefile
+ *
+ * The C library headers the project uses are read as they are,
+ * then int is made 16 bits as it is on the PIC24 so the project
+ * wraps around the same way. -Dint=short on the command line
+ * would reach into the C library headers as well.
+ */
+#ifndef HOST_H
+#define HOST_H
+
+#include <stddef.h>
+#include <string.h>
+
+#define int short
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Both UART instances at once, each in its own mode
+ *
+ *   instance_bench [-c cycles] script
+ *
+ * Runs echo_step.c on the model with the driver as it was built,
+ * each UART polled or interrupt driven, while the host sends the
+ * script to both. The bench steps the model until a byte is
+ * ready for a UART, in its RX FIFO when polled, in the ring
+ * buffer once the RX interrupt has run when interrupt driven,
+ * then makes that UART's echo call. For each UART it lists, for
+ * one byte echoed:
+ *
+ *   main       cycles in the echo call
+ *   ISR        cycles in that UART's RX and TX interrupts,
+ *              entry and exit included
+ *   CPU        the two together
+ *
+ * The bytes echoed on each UART must be the bytes sent to it, in
+ * order, with none lost. The script must space the bytes so the
+ * polled echo keeps up, it is not a throughput test. The polls
+ * that find nothing between bytes are not counted, a polled main
+ * loop spends them whenever it has nothing else to do.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xc.h"
+#include "model.h"
+
+/* echo_step.c as built for the host, see host.h */
+void Echo_Init(void);
+void Echo_U1(void);
+void Echo_U2(void);
+
+static unsigned long handled[MODEL_UARTS];
+static unsigned long long mainCycles[MODEL_UARTS];
+static unsigned long long isrStart[MODEL_UARTS];
+static unsigned long expected[MODEL_UARTS];
+
+static int Interrupt(int Uart)
+{
+    return Uart ? _U2RXIE : _U1RXIE;
+}
+
+/* A byte is waiting for the echo call of Uart */
+static int Ready(int Uart)
+{
+    const ModelUart_t *m = &model.uart[Uart];
+
+    if(m->received <= handled[Uart])
+        return 0;
+    /* with interrupts, once the RX interrupt has emptied the FIFO */
+    return Interrupt(Uart) ? (m->fifoSize == 0) && !model.inIsr : 1;
+}
+
+static void Main(void)
+{
+    static void (*const Echo[MODEL_UARTS])(void) = { Echo_U1, Echo_U2 };
+    unsigned long long start, first;
+    int u, marked = 0, i;
+
+    first = ~0ULL;
+    for(i = 0; i < model.scriptSize; i++)
+        if(model.script[i].at < first)
+            first = model.script[i].at;
+    Echo_Init();
+    for(;;)
+    {
+        if(!marked && (model.cycle >= first))
+        {
+            /* the TX interrupt at init is not part of an echo */
+            for(u = 0; u < MODEL_UARTS; u++)
+                isrStart[u] = model.uart[u].isrCycles;
+            marked = 1;
+        }
+        for(u = 0; u < MODEL_UARTS; u++)
+        {
+            if(!Ready(u))
+                continue;
+            start = model.time.mainCycles;
+            Echo[u]();
+            mainCycles[u] += model.time.mainCycles - start;
+            handled[u]++;
+        }
+        for(u = 0; u < MODEL_UARTS; u++)
+            if(model.uart[u].outSize < expected[u])
+                break;
+        if(u == MODEL_UARTS)
+            return;
+        Model_Step(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *name[MODEL_UARTS] = { "UART1", "UART2" };
+    unsigned long long isr;
+    int opt, u, i, bad = 0;
+
+    Model_Reset();
+    while((opt = getopt(argc, argv, "c:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c': model.bbCycles = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-c cycles] script\n", argv[0]);
+            return 2;
+        }
+    }
+    if((optind != argc - 1) || Model_LoadScript(argv[optind]))
+    {
+        fprintf(stderr, "usage: %s [-c cycles] script\n", argv[0]);
+        return 2;
+    }
+    for(i = 0; i < model.scriptSize; i++)
+        expected[model.script[i].uart] += model.script[i].count;
+
+    if(!Model_Run(Main, MODEL_US(10000000UL)))
+    {
+        printf("FAIL: the echo did not finish\n");
+        return 1;
+    }
+
+    for(u = 0; u < MODEL_UARTS; u++)
+    {
+        const ModelUart_t *m = &model.uart[u];
+
+        if(!expected[u])
+            continue;
+        isr = m->isrCycles - isrStart[u];
+        printf("  %s %-9s main %4llu, ISR %4llu, CPU %4llu cycles a byte\n", name[u],
+            Interrupt(u) ? "interrupt" : "polled", mainCycles[u] / handled[u], isr / handled[u],
+            (mainCycles[u] + isr) / handled[u]);
+        if((m->outSize != m->sentSize) || memcmp(m->out, m->sent, m->sentSize) || m->overruns)
+        {
+            printf("FAIL: %s echoed %lu of %lu bytes, %lu overruns\n", name[u], m->outSize,
+                m->sentSize, m->overruns);
+            bad = 1;
+        }
+    }
+    return bad;
+}
@@ -0,0 +1,684 @@
+/*
+ * Host model of the PIC24F16KL401 peripherals the UART project
+ * uses, see model.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xc.h"
+#include "model.h"
+
+Model_t model;
+
+/* UTXISEL1:UTXISEL0 */
+#define TXI_SLOT    0   /* a character moves to the shift register */
+#define TXI_DONE    1   /* the last character has been sent */
+#define TXI_EMPTY   2   /* the FIFO has run empty */
+
+/* Registers of one UART, the bit fields are reached through macros */
+#define MODE(u)     (*((u) ? &U2MODEbits : &U1MODEbits))
+#define STA(u)      (*((u) ? &U2STAbits : &U1STAbits))
+#define BRG(u)      (*((u) ? &U2BRG : &U1BRG))
+#define TXREG(u)    (*((u) ? &U2TXREG : &U1TXREG))
+
+static void SetRxIf(int u) { if(u) _U2RXIF = 1; else _U1RXIF = 1; }
+static void SetTxIf(int u) { if(u) _U2TXIF = 1; else _U1TXIF = 1; }
+
+void Model_Reset(void)
+{
+    memset(&model, 0, sizeof(model));
+    model.bbCycles = MODEL_BB_CYCLES;
+    model.wakeCycles = MODEL_US(MODEL_WAKE_US);
+    model.stopAt = ~0ULL;
+    U1TXREG = XC_TXREG_EMPTY;
+    U2TXREG = XC_TXREG_EMPTY;
+    model.uart[0].burst = -1;
+    model.uart[1].burst = -1;
+}
+
+/*
+ * Read a host script, one line for each burst of bytes:
+ *
+ *   uart at_ms count gap_bits [byte ...]
+ *   baud uart rate
+ *
+ * The host starts sending count bytes to the UART, 1 or 2, at
+ * at_ms after reset, or once it has sent the line before. Each
+ * byte is followed by gap_bits idle bits. The bytes are the hex
+ * values listed, sent over and over, or a counting pattern that
+ * goes on from line to line when none are listed. A baud line
+ * sets the rate the host sends at, by default it is the rate
+ * the UART runs at. # starts a comment.
+ */
+int Model_LoadScript(const char *Path)
+{
+    FILE *file;
+    char line[512];
+    char *pos, *end;
+    ModelBurst_t *burst;
+    unsigned uart;
+    unsigned long rate;
+    double at;
+    int lineNo = 0;
+    int n;
+
+    file = fopen(Path, "r");
+    if(file == NULL)
+    {
+        perror(Path);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), file))
+    {
+        lineNo++;
+        if(strchr(line, '#'))
+            *strchr(line, '#') = 0;
+        if(strspn(line, " \t\r\n") == strlen(line))
+            continue;
+        if(sscanf(line, " baud %u %lu", &uart, &rate) == 2)
+        {
+            if((uart < 1) || (uart > MODEL_UARTS) || (rate == 0))
+                goto bad;
+            model.uart[uart - 1].hostBaud = rate;
+            continue;
+        }
+        if(model.scriptSize >= MODEL_SCRIPT_MAX)
+            goto bad;
+        burst = &model.script[model.scriptSize];
+        memset(burst, 0, sizeof(*burst));
+        if((sscanf(line, "%u %lf %lu %u%n", &uart, &at, &burst->count, &burst->gapBits, &n) != 4)
+            || (uart < 1) || (uart > MODEL_UARTS) || (at < 0))
+            goto bad;
+        burst->uart = (int)uart - 1;
+        burst->at = (unsigned long long)(at * 1000.0) * (MODEL_FCYC / 1000000UL);
+        pos = line + n;
+        for(;;)
+        {
+            rate = strtoul(pos, &end, 16);
+            if(end == pos)
+                break;
+            if((rate > 0xFF) || (burst->dataSize >= (int)sizeof(burst->data)))
+                goto bad;
+            burst->data[burst->dataSize++] = (unsigned char)rate;
+            pos = end;
+        }
+        if(strspn(pos, " \t\r\n") != strlen(pos))
+            goto bad;
+        model.scriptSize++;
+    }
+    fclose(file);
+    return 0;
+
+bad:
+    fprintf(stderr, "%s:%d: bad line\n", Path, lineNo);
+    fclose(file);
+    return -1;
+}
+
+void Model_AddWait(const void *Func)
+{
+    if(model.waits < MODEL_WAIT_MAX)
+        model.wait[model.waits++] = Func;
+}
+
+/*
+ * Cycles for one bit at the rate the UART runs at
+ */
+unsigned long Model_BitCycles(int Uart)
+{
+    return (MODE(Uart).BRGH ? 4UL : 16UL) * ((unsigned long)BRG(Uart) + 1UL);
+}
+
+static unsigned long HostBitCycles(int u)
+{
+    unsigned long baud = model.uart[u].hostBaud;
+
+    if(baud == 0)
+        return Model_BitCycles(u);
+    return (MODEL_FCYC + baud / 2) / baud;
+}
+
+/* The UART clock is off in Sleep and until the wake-up is done */
+static int ClockOn(void)
+{
+    return !model.sleeping;
+}
+
+/* RTS of the UART, off while the receive FIFO is full */
+static int RtsOn(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+
+    if((MODE(u).UEN != 0b10) || MODE(u).RTSMD)
+        return 1;
+    return m->fifoSize < MODEL_FIFO;
+}
+
+static void Lose(ModelUart_t *m, unsigned char Ch)
+{
+    if(m->lostSize < MODEL_STREAM_MAX)
+        m->lost[m->lostSize++] = Ch;
+}
+
+/*
+ * Status bits the UART drives
+ */
+static void Status(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+
+    STA(u).URXDA = m->fifoSize > 0;
+    STA(u).FERR = (m->fifoSize > 0) && m->fifoErr[0];
+    STA(u).PERR = 0;
+    STA(u).OERR = m->oerr;
+    STA(u).RIDLE = !m->rxBusy;
+    STA(u).UTXBF = m->txSize >= MODEL_FIFO;
+    STA(u).TRMT = !m->tsrBusy && (m->txSize == 0);
+}
+
+/*
+ * Catch up with what the code wrote since the last step
+ */
+static void Sync(void)
+{
+    ModelUart_t *m;
+    int u;
+
+    for(u = 0; u < MODEL_UARTS; u++)
+    {
+        m = &model.uart[u];
+        if(!MODE(u).UARTEN)
+        {
+            m->fifoSize = 0;
+            m->txSize = 0;
+            m->tsrBusy = 0;
+            m->oerr = 0;
+        }
+        /* Clearing OERR empties the FIFO and restarts the receiver */
+        if(m->oerr && !STA(u).OERR)
+        {
+            m->fifoSize = 0;
+            m->oerr = 0;
+        }
+        if(STA(u).UTXEN && !m->utxen)
+            SetTxIf(u);
+        if(!STA(u).UTXEN)
+        {
+            m->txSize = 0;
+            m->tsrBusy = 0;
+        }
+        m->utxen = STA(u).UTXEN;
+        if(TXREG(u) != XC_TXREG_EMPTY)
+        {
+            if(MODE(u).UARTEN && STA(u).UTXEN && (m->txSize < MODEL_FIFO))
+                m->txFifo[m->txSize++] = (unsigned char)TXREG(u);
+            else
+                m->txDropped++;
+            TXREG(u) = XC_TXREG_EMPTY;
+        }
+        Status(u);
+    }
+}
+
+/*
+ * UxRXREG read, take the character at the top of the FIFO
+ */
+unsigned short XC_ReadRxReg(unsigned char Uart)
+{
+    int u = Uart - 1;
+    ModelUart_t *m = &model.uart[u];
+    unsigned short ch;
+
+    Sync();
+    if(m->fifoSize == 0)
+        return m->fifo[0];
+    ch = m->fifo[0];
+    m->fifoSize--;
+    memmove(&m->fifo[0], &m->fifo[1], m->fifoSize);
+    memmove(&m->fifoErr[0], &m->fifoErr[1], m->fifoSize);
+    Status(u);
+    if(model.wakeWaiting)
+    {
+        model.wakeWaiting = 0;
+        model.wakeToByte += model.cycle - model.wakeEdge;
+        if(model.cycle - model.wakeEdge > model.wakeToByteMax)
+            model.wakeToByteMax = (unsigned long)(model.cycle - model.wakeEdge);
+        model.wakeToByteCount++;
+    }
+    return ch;
+}
+
+/*
+ * Next byte the host sends on a UART, -1 when the script is done
+ */
+static int HostNext(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+    ModelBurst_t *b;
+
+    for(;;)
+    {
+        if(m->burst >= model.scriptSize)
+            return -1;
+        if(m->burst >= 0)
+        {
+            b = &model.script[m->burst];
+            if(m->burstSent < b->count)
+            {
+                if(model.cycle < b->at)
+                    return -1;
+                if(b->dataSize)
+                    return b->data[m->burstSent % b->dataSize];
+                return m->pattern;
+            }
+        }
+        /* next line for this UART */
+        do
+            m->burst++;
+        while((m->burst < model.scriptSize) && (model.script[m->burst].uart != u));
+        m->burstSent = 0;
+    }
+}
+
+/*
+ * A character has ended on the RX line
+ */
+static void Receive(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+    unsigned long bit = Model_BitCycles(u);
+    unsigned long host = HostBitCycles(u);
+    unsigned long scale, brg;
+    int ferr;
+
+    m->rxBusy = 0;
+    if(!MODE(u).UARTEN)
+    {
+        m->offLost++;
+        Lose(m, m->rxByte);
+        return;
+    }
+    if(m->rxLost)
+    {
+        m->sleepLost++;
+        Lose(m, m->rxByte);
+        return;
+    }
+    if(MODE(u).ABAUD)
+    {
+        /* the sync byte sets the BRG and is not received */
+        scale = MODE(u).BRGH ? 4UL : 16UL;
+        brg = (host + scale / 2) / scale;
+        BRG(u) = (unsigned short)(brg ? brg - 1 : 0);
+        MODE(u).ABAUD = 0;
+        SetRxIf(u);
+        return;
+    }
+    if(m->oerr || (m->fifoSize >= MODEL_FIFO))
+    {
+        if(!m->oerr)
+            m->overruns++;
+        m->oerr = 1;
+        m->overrunLost++;
+        Lose(m, m->rxByte);
+        return;
+    }
+    ferr = ((host > bit) ? host - bit : bit - host) * 100 > 4 * bit;
+    m->fifo[m->fifoSize] = m->rxByte;
+    m->fifoErr[m->fifoSize] = (unsigned char)ferr;
+    m->fifoSize++;
+    m->received++;
+    if(ferr)
+        m->framing++;
+    switch(STA(u).URXISEL)
+    {
+    case 0b10: if(m->fifoSize >= 3) SetRxIf(u); break;
+    case 0b11: if(m->fifoSize >= MODEL_FIFO) SetRxIf(u); break;
+    default: SetRxIf(u); break;
+    }
+}
+
+/* Bit times from the start bit to the first rising edge of a character */
+static unsigned FirstRise(unsigned char Ch)
+{
+    unsigned n = 1;
+
+    while((n < 9) && !(Ch & 1))
+    {
+        Ch >>= 1;
+        n++;
+    }
+    return n;
+}
+
+/*
+ * The host side of a UART for one cycle
+ */
+static void Host(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+    unsigned long bit;
+    int ch;
+
+    if(m->rxBusy)
+    {
+        if(model.cycle >= m->rxDone)
+        {
+            Receive(u);
+            bit = HostBitCycles(u);
+            if(m->burst < model.scriptSize)
+                m->nextStart = model.cycle + model.script[m->burst].gapBits * bit;
+        }
+        return;
+    }
+    if(model.cycle < m->nextStart)
+        return;
+    ch = HostNext(u);
+    if(ch < 0)
+        return;
+    if(!RtsOn(u))
+    {
+        m->rtsHeld++;
+        return;
+    }
+    bit = HostBitCycles(u);
+    m->rxBusy = 1;
+    m->rxByte = (unsigned char)ch;
+    m->rxDone = model.cycle + 10 * bit;
+    m->rxLost = !ClockOn();
+    if(model.sleeping && !model.wakeAt && MODE(u).WAKE)
+    {
+        /* the falling edge wakes the part, WAKE clears on the next rising edge */
+        model.wakeAt = model.cycle + model.wakeCycles;
+        model.wakeEdge = model.cycle;
+        model.wakeWaiting = 1;
+        model.wakes++;
+        m->wakeClearAt = model.cycle + FirstRise(m->rxByte) * bit;
+        SetRxIf(u);
+    }
+    if(m->sentSize < MODEL_STREAM_MAX)
+    {
+        m->sentAt[m->sentSize] = model.cycle;
+        m->sent[m->sentSize++] = m->rxByte;
+    }
+    m->burstSent++;
+    if(model.script[m->burst].dataSize == 0)
+        m->pattern++;
+}
+
+/*
+ * The UART side of a UART for one cycle, while its clock runs
+ */
+static void Uart(int u)
+{
+    ModelUart_t *m = &model.uart[u];
+    int txisel;
+
+    if(!MODE(u).UARTEN || !STA(u).UTXEN)
+        return;
+    txisel = (STA(u).UTXISEL1 << 1) | STA(u).UTXISEL0;
+    if(m->tsrBusy && (model.cycle >= m->tsrDone))
+    {
+        m->tsrBusy = 0;
+        if(m->outSize < MODEL_STREAM_MAX)
+        {
+            m->outAt[m->outSize] = model.cycle;
+            m->out[m->outSize++] = m->tsr;
+        }
+        if((txisel == TXI_DONE) && (m->txSize == 0))
+            SetTxIf(u);
+    }
+    if(!m->tsrBusy && m->txSize)
+    {
+        m->tsr = m->txFifo[0];
+        m->txSize--;
+        memmove(&m->txFifo[0], &m->txFifo[1], m->txSize);
+        m->tsrBusy = 1;
+        m->tsrDone = model.cycle + 10 * Model_BitCycles(u);
+        if((txisel == TXI_SLOT) || ((txisel == TXI_EMPTY) && (m->txSize == 0)))
+            SetTxIf(u);
+    }
+}
+
+/*
+ * One instruction cycle of the peripherals, Cpu is set when the
+ * core runs an instruction
+ */
+static void Tick(int Cpu)
+{
+    static const unsigned prescale[4] = { 1, 8, 64, 256 };
+    int u;
+
+    if(model.cycle == model.markAt)
+        model.mark = model.time;
+    model.cycle++;
+    if(Cpu && model.disi)
+        model.disi--;
+
+    if(model.wakeAt && (model.cycle >= model.wakeAt))
+    {
+        model.sleeping = 0;
+        model.wakeAt = 0;
+    }
+
+    /* WAKE clears on the first rising edge of the wake character */
+    for(u = 0; u < MODEL_UARTS; u++)
+    {
+        if(model.uart[u].wakeClearAt && (model.cycle >= model.uart[u].wakeClearAt))
+        {
+            model.uart[u].wakeClearAt = 0;
+            MODE(u).WAKE = 0;
+        }
+    }
+
+    for(u = 0; u < MODEL_UARTS; u++)
+        Host(u);
+
+    if(!ClockOn())
+    {
+        for(u = 0; u < MODEL_UARTS; u++)
+            Status(u);
+        return;
+    }
+
+    if(T1CONbits.TON && (++model.pre1 >= prescale[T1CONbits.TCKPS]))
+    {
+        model.pre1 = 0;
+        if(TMR1 == PR1)
+        {
+            TMR1 = 0;
+            _T1IF = 1;
+        }
+        else
+            TMR1++;
+    }
+
+    for(u = 0; u < MODEL_UARTS; u++)
+    {
+        Uart(u);
+        Status(u);
+    }
+}
+
+/*
+ * Highest interrupt that is enabled and flagged, in natural order
+ * as all run at priority 4. Returns its handler or NULL.
+ */
+static void (*Pending(int *Priority))(void)
+{
+    if(_T1IE && _T1IF && _T1IP && _T1Interrupt)
+        return *Priority = _T1IP, _T1Interrupt;
+    if(_U1RXIE && _U1RXIF && _U1RXIP && _U1RXInterrupt)
+        return *Priority = _U1RXIP, _U1RXInterrupt;
+    if(_U1TXIE && _U1TXIF && _U1TXIP && _U1TXInterrupt)
+        return *Priority = _U1TXIP, _U1TXInterrupt;
+    if(_U2RXIE && _U2RXIF && _U2RXIP && _U2RXInterrupt)
+        return *Priority = _U2RXIP, _U2RXInterrupt;
+    if(_U2TXIE && _U2TXIF && _U2TXIP && _U2TXInterrupt)
+        return *Priority = _U2TXIP, _U2TXInterrupt;
+    return NULL;
+}
+
+/* Any interrupt that wakes the core from Idle or Sleep */
+static int WakeFlag(void)
+{
+    int priority;
+
+    return Pending(&priority) != NULL;
+}
+
+static void Interrupt(void (*Handler)(void))
+{
+    unsigned long long start, isr;
+    int n;
+
+    start = model.cycle;
+    isr = model.time.isrCycles;
+    model.inIsr = 1;
+    for(n = 0; n < MODEL_ENTRY_CYCLES; n++, model.time.isrCycles++)
+        Tick(1);
+    model.time.isrRuns++;
+    Handler();
+    Sync();
+    for(n = 0; n < MODEL_RETFIE_CYCLES; n++, model.time.isrCycles++)
+        Tick(1);
+    model.inIsr = 0;
+    if((Handler == _U1RXInterrupt) || (Handler == _U1TXInterrupt))
+        model.uart[0].isrCycles += model.time.isrCycles - isr;
+    else if((Handler == _U2RXInterrupt) || (Handler == _U2TXInterrupt))
+        model.uart[1].isrCycles += model.time.isrCycles - isr;
+    if(model.cycle - start > model.isrMax)
+        model.isrMax = (unsigned long)(model.cycle - start);
+}
+
+static void Stop(void)
+{
+    if(model.cycle >= model.stopAt)
+        longjmp(model.stop, 1);
+}
+
+void Model_Step(unsigned Cycles)
+{
+    void (*handler)(void);
+    int priority;
+
+    Sync();
+    while(Cycles--)
+    {
+        Tick(1);
+        if(model.inIsr)
+            model.time.isrCycles++;
+        else
+        {
+            model.time.mainCycles++;
+            if(model.waitDepth > 0)
+                model.time.busyCycles++;
+        }
+    }
+    if(!model.inIsr)
+    {
+        handler = Pending(&priority);
+        if(handler && ((model.disi == 0) || (priority == 7)))
+        {
+            /* an ISR is counted in isrCycles, not main */
+            Interrupt(handler);
+        }
+    }
+    Stop();
+}
+
+/*
+ * The core stops until an interrupt is flagged. With DISI still
+ * counting it is not taken, the code after Idle runs first.
+ */
+void XC_Idle(void)
+{
+    Sync();
+    while(!WakeFlag())
+    {
+        Tick(0);
+        model.time.idleCycles++;
+        Stop();
+    }
+}
+
+void XC_Sleep(void)
+{
+    int u;
+
+    Sync();
+    if(WakeFlag())
+        return;
+    model.sleeping = 1;
+    for(u = 0; u < MODEL_UARTS; u++)
+        if(model.uart[u].rxBusy)
+            model.uart[u].rxLost = 1;   /* the clock stops under it */
+    while(model.sleeping || !WakeFlag())
+    {
+        Tick(0);
+        model.time.sleepCycles++;
+        Stop();
+        if(!model.sleeping && !WakeFlag())
+            model.sleeping = 1;     /* woke for nothing, stay asleep */
+    }
+}
+
+void XC_Disi(unsigned short Cycles)
+{
+    model.disi = Cycles;
+}
+
+/*
+ * Called by the compiler at each basic block of the project
+ */
+void __sanitizer_cov_trace_pc(void)
+{
+    Model_Step(model.bbCycles);
+}
+
+/*
+ * Called by the compiler at the entry and exit of each function
+ * of the project
+ */
+static int IsWait(const void *Func)
+{
+    int n;
+
+    for(n = 0; n < model.waits; n++)
+        if(model.wait[n] == Func)
+            return 1;
+    return 0;
+}
+
+void __cyg_profile_func_enter(void *Func, void *Site)
+{
+    (void)Site;
+    if(!model.inIsr && IsWait(Func))
+        model.waitDepth++;
+}
+
+void __cyg_profile_func_exit(void *Func, void *Site)
+{
+    (void)Site;
+    if(!model.inIsr && IsWait(Func))
+        model.waitDepth--;
+}
+
+/*
+ * Run Main for Cycles, returns 1 when it returned by itself
+ */
+int Model_Run(void (*Main)(void), unsigned long long Cycles)
+{
+    model.stopAt = model.cycle + Cycles;
+    if(setjmp(model.stop) == 0)
+    {
+        Main();
+        model.stopAt = ~0ULL;
+        return 1;
+    }
+    model.stopAt = ~0ULL;
+    model.inIsr = 0;
+    model.waitDepth = 0;
+    model.sleeping = 0;
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Host model of the PIC24F16KL401 peripherals the UART project uses
+ *
+ * The project sources are built with -fsanitize-coverage=trace-pc,
+ * the compiler then calls __sanitizer_cov_trace_pc at each basic
+ * block. The model charges MODEL_BB_CYCLES instruction cycles for
+ * each one, runs the peripherals for that time and takes an
+ * interrupt when one is due, so the main loop and the interrupt
+ * handlers run on the model clock as they would on the part.
+ *
+ * The cycle counts are rough. A basic block on the host is about
+ * one C statement, on the part it is a few instructions. Use the
+ * numbers to compare builds and to see where the time goes, not
+ * as the cycle count of the part.
+ *
+ * Modelled, at FCYC:
+ *   UART1/2    BRG and BRGH baud clock, 4 deep TX FIFO and shift
+ *              register, 4 deep RX FIFO, URXDA, UTXBF, TRMT, RIDLE,
+ *              OERR when a character ends with the FIFO full, FERR
+ *              when the host baud rate is more than 4% off, ABAUD
+ *              on the next character, WAKE, RTS flow control with
+ *              UEN 0b10, UTXISEL and URXISEL, TXIF when UTXEN is set
+ *   TIMER1     prescaler, PR1 match, stops in Sleep
+ *   core       DISI, Idle and Sleep, interrupt priority and natural
+ *              order, no nesting as main sets NSTDIS
+ *
+ * The host at the other end of each UART sends the bytes of a
+ * script, see Model_LoadScript, at its own baud rate, and holds
+ * the next start bit while RTS is off. It takes everything the
+ * UART sends, the UART CTS input is always on.
+ *
+ * Idle, Sleep and the busy-wait time
+ *
+ *   Idle stops the core until an enabled interrupt flag is set,
+ *   the peripherals keep running. In Sleep only the UART WAKE
+ *   logic runs: the falling edge of a start bit with WAKE set
+ *   sets RXIF and clears WAKE, the core and the UART clock run
+ *   again wakeCycles later. That character, and any whose start
+ *   bit comes before the clock runs again, is lost. The wake-up
+ *   time of the part depends on the oscillator start-up and the
+ *   regulator mode, and varies with VDD and temperature, so it is
+ *   an input to the model, not something it works out.
+ *
+ *   The project sources are also built with -finstrument-functions.
+ *   Cycles the main line spends inside a function listed with
+ *   Model_AddWait, the driver calls that wait for the UART, are
+ *   counted as busy-wait cycles. The cycles of the pass that
+ *   finally gets through are counted too.
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <setjmp.h>
+
+#define MODEL_FCYC          1000000UL   /* FCYC in init.h */
+#define MODEL_BB_CYCLES     3           /* cycles for each basic block */
+#define MODEL_ENTRY_CYCLES  5           /* interrupt flag to the first ISR instruction */
+#define MODEL_RETFIE_CYCLES 3
+#define MODEL_WAKE_US       10          /* default Sleep wake-up time */
+#define MODEL_UARTS         2
+#define MODEL_FIFO          4
+#define MODEL_SCRIPT_MAX    64          /* script lines */
+#define MODEL_STREAM_MAX    200000      /* bytes kept for each direction */
+#define MODEL_WAIT_MAX      16
+
+#define MODEL_US(us)        ((unsigned long long)(us) * (MODEL_FCYC / 1000000UL))
+
+/* One line of the host script, see Model_LoadScript */
+typedef struct {
+    int uart;                           /* 0 for UART1, 1 for UART2 */
+    unsigned long long at;              /* cycle of the first start bit */
+    unsigned long count;
+    unsigned gapBits;                   /* idle bits after each byte */
+    unsigned char data[64];
+    int dataSize;                       /* 0 sends a counting pattern */
+} ModelBurst_t;
+
+typedef struct {
+    /* host side */
+    unsigned long hostBaud;             /* 0 for the rate the UART runs at */
+    int burst;                          /* script line being sent */
+    unsigned long burstSent;
+    unsigned long long nextStart;
+    unsigned char pattern;              /* next byte of the counting pattern */
+    unsigned char sent[MODEL_STREAM_MAX];      /* bytes the host sent */
+    unsigned long long sentAt[MODEL_STREAM_MAX];
+    unsigned long sentSize;
+
+    /* receiver, the character on the line */
+    int rxBusy;
+    unsigned long long rxDone;
+    unsigned char rxByte;
+    int rxLost;                         /* started while the UART clock was off */
+    unsigned long long wakeClearAt;     /* first rising edge of the wake character */
+    unsigned char fifo[MODEL_FIFO];
+    unsigned char fifoErr[MODEL_FIFO];
+    int fifoSize;
+    int oerr;                           /* OERR as the model left it */
+
+    /* transmitter */
+    unsigned char txFifo[MODEL_FIFO];
+    int txSize;
+    int tsrBusy;
+    unsigned long long tsrDone;
+    unsigned char tsr;
+    int utxen;                          /* UTXEN as last seen */
+    unsigned char out[MODEL_STREAM_MAX];        /* bytes the UART sent */
+    unsigned long long outAt[MODEL_STREAM_MAX];
+    unsigned long outSize;
+
+    /* counts */
+    unsigned long received;             /* characters put in the RX FIFO */
+    unsigned long overruns;             /* times OERR was set */
+    unsigned long overrunLost;          /* characters lost to OERR */
+    unsigned long sleepLost;            /* characters lost while the clock was off */
+    unsigned long offLost;              /* characters sent to a disabled UART */
+    unsigned long framing;              /* characters taken with FERR */
+    unsigned long txDropped;            /* writes to a full TX FIFO */
+    unsigned char lost[MODEL_STREAM_MAX];       /* values of the lost characters */
+    unsigned long lostSize;
+    unsigned long rtsHeld;              /* cycles the host waited on RTS */
+    unsigned long long isrCycles;       /* in this UART's interrupts, entry and exit included */
+} ModelUart_t;
+
+/* Where the time went, in cycles */
+typedef struct {
+    unsigned long long mainCycles;      /* main line running */
+    unsigned long long busyCycles;      /* of those, in a Model_AddWait function */
+    unsigned long long isrCycles;       /* in interrupts, entry and exit included */
+    unsigned long long idleCycles;
+    unsigned long long sleepCycles;
+    unsigned long isrRuns;
+} ModelTime_t;
+
+typedef struct {
+    unsigned long long cycle;           /* FCYC cycles since reset */
+    unsigned long long stopAt;          /* end of the run */
+    unsigned bbCycles;
+    unsigned long wakeCycles;
+    jmp_buf stop;
+
+    /* core */
+    int inIsr;
+    unsigned disi;                      /* DISICNT */
+    int sleeping;
+    unsigned long long wakeAt;          /* clock runs again, 0 when not waking */
+    unsigned long long wakeEdge;        /* start bit that woke the part */
+    unsigned long wakes;
+    unsigned long long wakeToByte;      /* sum of wake edge to the next byte read */
+    unsigned long wakeToByteMax;
+    unsigned long wakeToByteCount;
+    int wakeWaiting;                    /* a byte after the wake is waited for */
+    const void *wait[MODEL_WAIT_MAX];   /* Model_AddWait functions */
+    int waits;
+    int waitDepth;
+
+    /* time */
+    ModelTime_t time;
+    ModelTime_t mark;                   /* time as it was at markAt */
+    unsigned long long markAt;
+    unsigned long isrMax;
+
+    /* TIMER1 */
+    unsigned pre1;
+
+    ModelUart_t uart[MODEL_UARTS];
+    ModelBurst_t script[MODEL_SCRIPT_MAX];
+    int scriptSize;
+} Model_t;
+
+extern Model_t model;
+
+void Model_Reset(void);
+int  Model_LoadScript(const char *Path);
+void Model_AddWait(const void *Func);
+void Model_Step(unsigned Cycles);
+int  Model_Run(void (*Main)(void), unsigned long long Cycles);
+unsigned long Model_BitCycles(int Uart);
+
+/* Interrupt handlers of the build, weak so a build may leave them out */
+void _T1Interrupt(void) __attribute__((weak));
+void _U1RXInterrupt(void) __attribute__((weak));
+void _U1TXInterrupt(void) __attribute__((weak));
+void _U2RXInterrupt(void) __attribute__((weak));
+void _U2TXInterrupt(void) __attribute__((weak));
+
+#endif
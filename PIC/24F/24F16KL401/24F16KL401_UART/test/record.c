@@ -0,0 +1,43 @@
+/*
+ * One telemetry record sent two ways, for record_bench
+ *
+ *   ADC 0x03FF       3300 mV\r\n
+ *
+ * Record_PerChar sends it as uart.c did before format.c, each
+ * character through the PutChar pointer of the Generic_ helpers
+ * in generic_ref.c. Record_Render renders it into a buffer on the
+ * stack with format.c and sends it with one U2_PutBuffer, as
+ * main.c sends its status record. Both send the same 26 bytes.
+ *
+ * Built with the project sources, so it runs on the model clock.
+ */
+#include <xc.h>
+#include "uart.h"
+#include "format.h"
+
+void Ref_PutDec( void (*Ux_PutChar)(char), unsigned long Dec32 );
+void Ref_PutHexWord( void (*Ux_PutChar)(char), unsigned short Hex );
+void Ref_PutString( void (*Ux_PutChar)(char), char *pBuf );
+
+void Record_PerChar( unsigned short Raw, unsigned short Millivolts )
+{
+    Ref_PutString(&U2_PutChar, "ADC 0x");
+    Ref_PutHexWord(&U2_PutChar, Raw);
+    Ref_PutString(&U2_PutChar, " ");
+    Ref_PutDec(&U2_PutChar, Millivolts);
+    Ref_PutString(&U2_PutChar, " mV\r\n");
+}
+
+void Record_Render( unsigned short Raw, unsigned short Millivolts )
+{
+    char Line[32];
+    char *pLine;
+
+    pLine = Line;
+    pLine += Fmt_String(pLine, "ADC 0x");
+    pLine += Fmt_HexWord(pLine, Raw);
+    pLine += Fmt_String(pLine, " ");
+    pLine += Fmt_Dec16(pLine, Millivolts, FMT_DEC32_DIGITS, 0);
+    pLine += Fmt_String(pLine, " mV\r\n");
+    U2_PutBuffer(Line, pLine - Line);
+}
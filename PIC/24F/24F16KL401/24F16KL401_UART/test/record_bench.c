@@ -0,0 +1,119 @@
+/*
+ * Cycles for each telemetry record, rendered against per character
+ *
+ *   record_bench [-c cycles]
+ *
+ * Runs the two ways of sending a record in record.c on the model,
+ * RECORDS times each with a new value, with the driver as it was
+ * built, interrupt or with BENCH_POLLED polled. Each record is
+ * sent then the bench waits for its last stop bit before the next
+ * one. For each way it lists, for one record:
+ *
+ *   main       cycles in the call that sends the record
+ *   driver     of those, cycles in U2_PutChar and U2_PutBuffer,
+ *              the polled driver waits there for room in the FIFO
+ *   ISR        cycles in interrupts until the last stop bit
+ *   CPU        main and ISR, the time the core is not free
+ *
+ * The bytes each way sends must be the same.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xc.h"
+#include "model.h"
+
+#define RECORDS 20
+
+#ifndef BENCH_POLLED
+#define BENCH_POLLED 0
+#endif
+
+/* record.c and uart.c as built for the host, int is short, see host.h */
+void Record_PerChar(unsigned short Raw, unsigned short Millivolts);
+void Record_Render(unsigned short Raw, unsigned short Millivolts);
+void U2_Init(void);
+void U2_PutChar(char Ch);
+void U2_PutBuffer(const char *pBuf, size_t Len);
+size_t U2_Write(const char *pBuf, size_t Len);
+
+typedef struct {
+    unsigned long long main, busy, isr;
+    unsigned long from, to;             /* bytes of the UART2 output */
+} Way_t;
+
+static Way_t way[2];
+
+static void Send(Way_t *pWay, void (*Record)(unsigned short, unsigned short))
+{
+    ModelTime_t start, sent;
+    unsigned short n;
+
+    pWay->from = model.uart[1].outSize;
+    for(n = 0; n < RECORDS; n++)
+    {
+        start = model.time;
+        Record((unsigned short)(0x0123 * n), (unsigned short)(3300 + 7 * n));
+        sent = model.time;
+        /* wait for the last stop bit, the TX interrupt may still run */
+        while(model.uart[1].outSize - pWay->from < (n + 1UL) * 26UL)
+            Model_Step(1);
+        pWay->main += sent.mainCycles - start.mainCycles;
+        pWay->busy += sent.busyCycles - start.busyCycles;
+        pWay->isr += model.time.isrCycles - start.isrCycles;
+    }
+    pWay->to = model.uart[1].outSize;
+}
+
+static void Main(void)
+{
+    U2_Init();
+    Send(&way[0], Record_PerChar);
+    Send(&way[1], Record_Render);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *name[2] = { "per character", "rendered" };
+    unsigned long bytes;
+    int opt, w;
+
+    Model_Reset();
+    while((opt = getopt(argc, argv, "c:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c': model.bbCycles = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-c cycles]\n", argv[0]);
+            return 2;
+        }
+    }
+    Model_AddWait((const void *)U2_PutChar);
+    Model_AddWait((const void *)U2_PutBuffer);
+    Model_AddWait((const void *)U2_Write);
+
+    if(!Model_Run(Main, MODEL_US(10000000UL)))
+    {
+        printf("FAIL: the records were not all sent\n");
+        return 1;
+    }
+
+    printf("%s driver, %d records of 26 bytes at %lu baud, %u cycles a basic block\n",
+        BENCH_POLLED ? "polled" : "interrupt", RECORDS,
+        MODEL_FCYC / Model_BitCycles(1), model.bbCycles);
+    for(w = 0; w < 2; w++)
+    {
+        printf("  %-14s main %6llu (driver %6llu), ISR %5llu, CPU %6llu cycles a record\n", name[w],
+            way[w].main / RECORDS, way[w].busy / RECORDS, way[w].isr / RECORDS,
+            (way[w].main + way[w].isr) / RECORDS);
+    }
+    bytes = way[0].to - way[0].from;
+    if((bytes != way[1].to - way[1].from) || memcmp(&model.uart[1].out[way[0].from], &model.uart[1].out[way[1].from], bytes))
+    {
+        printf("FAIL: the two ways sent different bytes\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,5 @@
+/*
+ * Storage for the registers declared in xc.h
+ */
+#define XC_SFR_DEFINE
+#include "xc.h"
@@ -0,0 +1,122 @@
+/*
+ * Check of the baud rate solver in uart.h
+ *
+ * The Makefile builds this file for each FOSC and pair of baud
+ * rates it lists, with -DFOSC, -DU1_BAUD and -DU2_BAUD. The BRGH
+ * and BRG the preprocessor picked for each UART are compared with
+ * a search of every BRG value with both BRGH settings, the error
+ * worked out the same way, in hundredths of a percent:
+ *
+ *  - when some setting is within UART_BAUD_ERROR_MAX the solver
+ *    must give the smallest error there is, and BRGH=1 only when
+ *    no BRGH=0 setting is as good
+ *  - when none is, the solver error must be over the limit too so
+ *    the build stops, uart_instance.h checks it
+ *  - Ux_BAUD_ERROR and Ux_REAL_BAUD must be those of Ux_BRGREG
+ *
+ * Within one BRGH the solver rounds BRG to nearest, which is not
+ * always the best BRG when the error is tens of percent. Those
+ * settings are over the limit either way so only the limit is
+ * checked for them.
+ *
+ * One line is printed for each UART, the exit code is 1 when a
+ * check fails.
+ */
+#include <stdio.h>
+#include "uart.h"
+
+/* Error of one setting as UART_BAUD_ERR works it out */
+static unsigned long long Error(unsigned long long Baud, unsigned long long Scale, unsigned long long Div)
+{
+    unsigned long long clocks = Scale * Baud * Div;
+
+    return (FCYC > clocks ? FCYC - clocks : clocks - FCYC) * 10000ULL / clocks;
+}
+
+static int Check(int Uart, unsigned long Baud, int Brgh, unsigned long long Brg,
+    unsigned long long BaudError, unsigned long long RealBaud)
+{
+    unsigned long long best[2] = { ~0ULL, ~0ULL };
+    unsigned long long e, least;
+    unsigned long long scale = Brgh ? 4 : 16;
+    unsigned long div;
+    int b, bad = 0;
+
+    for(b = 0; b < 2; b++)
+    {
+        for(div = 1; div <= 65536UL; div++)
+        {
+            e = Error(Baud, b ? 4 : 16, div);
+            if(e < best[b])
+                best[b] = e;
+        }
+    }
+    least = best[0] < best[1] ? best[0] : best[1];
+
+    printf("FCYC %lu U%d_BAUD %lu: ", (unsigned long)FCYC, Uart, Baud);
+    if(Brg > 65535ULL)
+    {
+        printf("no BRG, ");
+        if(BaudError <= UART_BAUD_ERROR_MAX)
+        {
+            printf("error %llu is within the limit, ", BaudError);
+            bad = 1;
+        }
+    }
+    else
+    {
+        printf("BRGH %d BRG %llu, %llu baud, error %llu.%02llu%%, ",
+            Brgh, Brg, RealBaud, BaudError / 100, BaudError % 100);
+        if(BaudError != Error(Baud, scale, Brg + 1))
+        {
+            printf("Ux_BAUD_ERROR is not the error of BRG, ");
+            bad = 1;
+        }
+        if(RealBaud != FCYC / (scale * (Brg + 1)))
+        {
+            printf("Ux_REAL_BAUD is not the rate of BRG, ");
+            bad = 1;
+        }
+    }
+    if(least <= UART_BAUD_ERROR_MAX)
+    {
+        if(BaudError != least)
+        {
+            printf("best error is %llu, ", least);
+            bad = 1;
+        }
+        if(Brgh && (best[0] <= least))
+        {
+            printf("BRGH=0 is as good, ");
+            bad = 1;
+        }
+    }
+    else if(BaudError <= UART_BAUD_ERROR_MAX)
+    {
+        printf("no setting is within the limit, ");
+        bad = 1;
+    }
+    printf("%s\n", bad ? "FAIL" : (BaudError <= UART_BAUD_ERROR_MAX ? "ok" : "ok, build stops"));
+    return bad;
+}
+
+/* Ux_REAL_BAUD divides by zero when BRG wrapped, the build stops first */
+#if U1_BRGREG > 65535
+#define U1_TEST_BAUD 0
+#else
+#define U1_TEST_BAUD U1_REAL_BAUD
+#endif
+#if U2_BRGREG > 65535
+#define U2_TEST_BAUD 0
+#else
+#define U2_TEST_BAUD U2_REAL_BAUD
+#endif
+
+int main(void)
+{
+    int bad = 0;
+
+    bad |= Check(1, U1_BAUD, U1_BRGH_VALUE, U1_BRGREG, U1_BAUD_ERROR, U1_TEST_BAUD);
+    bad |= Check(2, U2_BAUD, U2_BRGH_VALUE, U2_BRGREG, U2_BAUD_ERROR, U2_TEST_BAUD);
+    return bad;
+}
@@ -0,0 +1,129 @@
+/*
+ * Check of format.c against the C library
+ *
+ * Fmt_Dec16 is checked for every 16-bit value, Fmt_Dec32 for all
+ * values below 100000, each power of ten and of two and the
+ * values either side, and a million random values. Each is done
+ * at several widths with each layout flag and compared with
+ * snprintf. Fmt_Hex and Fmt_HexWord are checked for every value.
+ * Nothing may be stored past the count returned.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "format.h"
+
+#define GUARD 0x7F
+
+static unsigned long bad;
+static unsigned long checks;
+
+static void Compare(const char *What, unsigned long Value, unsigned Width, unsigned Flags,
+    const char *Buf, unsigned Count, const char *Want)
+{
+    checks++;
+    if((Count == strlen(Want)) && !memcmp(Buf, Want, Count) && (Buf[Count] == GUARD))
+        return;
+    if(bad++ < 10)
+        printf("  %s(%lu, %u, %u): \"%.*s\" %s, want \"%s\"\n", What, Value, Width, Flags,
+            Count, Buf, (Buf[Count] == GUARD) ? "" : "and more", Want);
+}
+
+static const char *Want(unsigned long Value, unsigned Width, unsigned Flags)
+{
+    static char want[32];
+
+    if(Flags & FMT_LEFT)
+        snprintf(want, sizeof(want), "%-*lu", Width, Value);
+    else if(Flags & FMT_ZERO)
+        snprintf(want, sizeof(want), "%0*lu", Width, Value);
+    else
+        snprintf(want, sizeof(want), "%*lu", Width, Value);
+    return want;
+}
+
+static const unsigned char Widths[] = { 0, 1, 3, 5, 7, 10, 12 };
+static const unsigned char Flags[] = { 0, FMT_LEFT, FMT_ZERO };
+
+static void Dec32(unsigned long Value)
+{
+    char buf[32];
+    unsigned w, f, n;
+
+    for(w = 0; w < sizeof(Widths); w++)
+    {
+        for(f = 0; f < sizeof(Flags); f++)
+        {
+            memset(buf, GUARD, sizeof(buf));
+            n = Fmt_Dec32(buf, Value, Widths[w], Flags[f]);
+            Compare("Fmt_Dec32", Value, Widths[w], Flags[f], buf, n, Want(Value, Widths[w], Flags[f]));
+        }
+    }
+}
+
+int main(void)
+{
+    char buf[32];
+    char want[8];
+    unsigned long v, p, seed;
+    unsigned w, f, n;
+
+    for(v = 0; v <= 0xFFFFUL; v++)
+    {
+        for(w = 0; w < sizeof(Widths); w++)
+        {
+            for(f = 0; f < sizeof(Flags); f++)
+            {
+                memset(buf, GUARD, sizeof(buf));
+                n = Fmt_Dec16(buf, (unsigned short)v, Widths[w], Flags[f]);
+                Compare("Fmt_Dec16", v, Widths[w], Flags[f], buf, n, Want(v, Widths[w], Flags[f]));
+            }
+        }
+        memset(buf, GUARD, sizeof(buf));
+        n = Fmt_HexWord(buf, (unsigned short)v);
+        snprintf(want, sizeof(want), "%04lX", v);
+        Compare("Fmt_HexWord", v, 0, 0, buf, n, want);
+        if(v <= 0xFF)
+        {
+            memset(buf, GUARD, sizeof(buf));
+            n = Fmt_Hex(buf, (unsigned char)v);
+            snprintf(want, sizeof(want), "%02lX", v);
+            Compare("Fmt_Hex", v, 0, 0, buf, n, want);
+        }
+    }
+
+    for(v = 0; v < 100000UL; v++)
+        Dec32(v);
+    for(p = 10; p <= 1000000000UL; p *= 10)
+    {
+        Dec32(p - 1);
+        Dec32(p);
+        Dec32(p + 1);
+        Dec32(p * 4 - 1);
+        Dec32(p * 4);
+    }
+    for(p = 1; p && (p <= 0xFFFFFFFFUL); p <<= 1)
+    {
+        Dec32(p - 1);
+        Dec32(p);
+        Dec32(p + 1);
+    }
+    Dec32(4294967295UL);
+    for(seed = 1, v = 0; v < 1000000UL; v++)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+        Dec32(seed);
+    }
+
+    memset(buf, GUARD, sizeof(buf));
+    n = Fmt_String(buf, "ADC ");
+    Compare("Fmt_String", 0, 0, 0, buf, n, "ADC ");
+    memset(buf, GUARD, sizeof(buf));
+    n = Fmt_String(buf, "");
+    Compare("Fmt_String", 0, 0, 0, buf, n, "");
+    memset(buf, GUARD, sizeof(buf));
+    n = Fmt_CrLf(buf);
+    Compare("Fmt_CrLf", 0, 0, 0, buf, n, "\r\n");
+
+    printf("format: %lu conversions, %lu wrong\n", checks, bad);
+    return bad != 0;
+}
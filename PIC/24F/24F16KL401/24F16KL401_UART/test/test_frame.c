@@ -0,0 +1,227 @@
+/*
+ * Check of frame.c, COBS framing with CRC-16
+ *
+ *  - Frame_Crc16 gives the CRC-16/CCITT check value 0x29B1 for
+ *    "123456789" and matches a bit at a time CRC on random data
+ *  - each payload length from 0 to FRAME_MAX_PAYLOAD, with no
+ *    zeros, all zeros, all 0xFF and random bytes, is encoded. The
+ *    frame must fit FRAME_ENCODED_MAX, have its only 0x00 at the
+ *    end and undo with a plain COBS decoder to the payload and its
+ *    CRC, high byte first. Frame_Decode, fed a byte at a time
+ *    after a run of frames, must give the payload back. Longer
+ *    payloads up to 253 bytes, past the 254 byte COBS block, are
+ *    checked with the plain decoder only
+ *  - every bit of a frame is flipped in turn. Frame_Decode must
+ *    never give a payload that was not sent, and the frame after
+ *    it must come through
+ *  - a decoder that starts part way through a frame must drop it,
+ *    frames longer than FRAME_MAX_PAYLOAD must be counted as
+ *    overflows
+ *
+ * Last it lists the bytes on the wire for the record of
+ * record.c, ASCII against a frame of the same values.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "frame.h"
+
+static unsigned long bad;
+static unsigned long seed = 1;
+
+static unsigned char Random(void)
+{
+    seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (unsigned char)(seed >> 16);
+}
+
+static void Fail(const char *Text, unsigned Len)
+{
+    if(bad++ < 10)
+        printf("  %s, payload of %u bytes\n", Text, Len);
+}
+
+static unsigned short BitCrc(const unsigned char *pData, size_t Len)
+{
+    unsigned short crc = 0xFFFF;
+    int b;
+
+    while(Len--)
+    {
+        crc ^= (unsigned short)(*pData++ << 8);
+        for(b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (unsigned short)((crc << 1) ^ 0x1021) : (unsigned short)(crc << 1);
+    }
+    return crc;
+}
+
+/* Plain COBS decode of a frame without its delimiter, -1 when bad */
+static long Unstuff(unsigned char *pOut, const unsigned char *pIn, size_t Len)
+{
+    size_t i = 0, o = 0;
+    unsigned code, k;
+
+    while(i < Len)
+    {
+        code = pIn[i++];
+        if(code == 0)
+            return -1;
+        for(k = 1; k < code; k++)
+        {
+            if(i >= Len)
+                return -1;
+            pOut[o++] = pIn[i++];
+        }
+        if((code < 0xFF) && (i < Len))
+            pOut[o++] = 0;
+    }
+    return (long)o;
+}
+
+/* Feed a frame to a decoder, returns the result of the last byte */
+static unsigned char Feed(FrameDecoder_t *pDec, const unsigned char *pFrame, size_t Len)
+{
+    unsigned char result = FRAME_BUSY;
+    size_t i;
+
+    for(i = 0; i < Len; i++)
+    {
+        result = Frame_Decode(pDec, pFrame[i]);
+        if((result != FRAME_BUSY) && (i + 1 < Len))
+        {
+            printf("  frame ended at byte %lu of %lu\n", (unsigned long)i, (unsigned long)Len);
+            return FRAME_ERROR;
+        }
+    }
+    return result;
+}
+
+static void RoundTrip(FrameDecoder_t *pDec, const unsigned char *pData, unsigned Len)
+{
+    unsigned char frame[FRAME_ENCODED_MAX(253)];
+    unsigned char plain[253 + 2];
+    unsigned short crc;
+    size_t n, i;
+
+    n = Frame_Encode(frame, pData, (unsigned char)Len);
+    if(n > FRAME_ENCODED_MAX(Len))
+        Fail("longer than FRAME_ENCODED_MAX", Len);
+    for(i = 0; i + 1 < n; i++)
+        if(frame[i] == 0)
+            break;
+    if((i + 1 != n) || frame[n - 1])
+        Fail("0x00 before the end or no delimiter", Len);
+    crc = BitCrc(pData, Len);
+    if((Unstuff(plain, frame, n - 1) != (long)Len + 2) || memcmp(plain, pData, Len) ||
+        (plain[Len] != (crc >> 8)) || (plain[Len + 1] != (crc & 0xFF)))
+        Fail("COBS decode is not the payload and CRC", Len);
+    if(Len > FRAME_MAX_PAYLOAD)
+        return;
+    if((Feed(pDec, frame, n) != FRAME_READY) || (pDec->Len != Len) || memcmp(pDec->Data, pData, Len))
+        Fail("Frame_Decode did not give the payload back", Len);
+}
+
+int main(void)
+{
+    static const unsigned char check[] = "123456789";
+    unsigned char data[256];
+    unsigned char frame[FRAME_ENCODED_MAX(255)];
+    unsigned char next[FRAME_ENCODED_MAX(FRAME_MAX_PAYLOAD)];
+    FrameDecoder_t dec;
+    unsigned len, kind, bit, bits, frames = 0;
+    unsigned long wrong = 0, dropped = 0;
+    size_t n, nextLen, i;
+    unsigned char result;
+
+    if(Frame_Crc16(0xFFFF, check, 9) != 0x29B1)
+        Fail("CRC of 123456789 is not 0x29B1", 9);
+    for(len = 0; len < 256; len++)
+    {
+        for(i = 0; i < len; i++)
+            data[i] = Random();
+        if(Frame_Crc16(0xFFFF, data, len) != BitCrc(data, len))
+            Fail("CRC is not the bit at a time CRC", len);
+    }
+
+    Frame_DecodeInit(&dec);
+    Frame_Decode(&dec, 0);
+    for(kind = 0; kind < 4; kind++)
+    {
+        for(len = 0; len <= 253; len++)
+        {
+            for(i = 0; i < len; i++)
+            {
+                switch(kind)
+                {
+                case 0: data[i] = (unsigned char)(i % 255 + 1); break;
+                case 1: data[i] = 0; break;
+                case 2: data[i] = 0xFF; break;
+                default: data[i] = (Random() & 3) ? Random() : 0; break;
+                }
+            }
+            RoundTrip(&dec, data, len);
+            frames++;
+        }
+    }
+    if(dec.CrcErrors || dec.Overflows)
+        Fail("errors counted for good frames", 0);
+
+    /* every bit of one frame flipped, then a good frame */
+    for(i = 0; i < 40; i++)
+        data[i] = (i & 7) ? Random() : 0;
+    n = Frame_Encode(frame, data, 40);
+    for(i = 0; i < 24; i++)
+        data[100 + i] = Random();
+    nextLen = Frame_Encode(next, &data[100], 24);
+    bits = (unsigned)(n - 1) * 8;
+    for(bit = 0; bit < bits; bit++)
+    {
+        frame[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+        for(i = 0; i < n; i++)
+        {
+            result = Frame_Decode(&dec, frame[i]);
+            if(result == FRAME_READY)
+                wrong++;
+            if(result == FRAME_ERROR)
+                dropped++;
+        }
+        frame[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+        if((Feed(&dec, next, nextLen) != FRAME_READY) || (dec.Len != 24) || memcmp(dec.Data, &data[100], 24))
+            Fail("no frame after a damaged one", 24);
+    }
+    if(wrong)
+        Fail("a damaged frame was taken as good", 40);
+
+    /* joined part way through */
+    Frame_DecodeInit(&dec);
+    if(Feed(&dec, &frame[5], n - 5) != FRAME_BUSY)
+        Fail("part of a frame was not dropped", 40);
+    if(Feed(&dec, next, nextLen) != FRAME_READY)
+        Fail("no frame after a part frame", 24);
+
+    /* too long */
+    for(i = 0; i < FRAME_MAX_PAYLOAD + 1; i++)
+        data[i] = Random();
+    n = Frame_Encode(frame, data, FRAME_MAX_PAYLOAD + 1);
+    result = FRAME_BUSY;
+    for(i = 0; (i < n) && (result == FRAME_BUSY); i++)
+        result = Frame_Decode(&dec, frame[i]);
+    if((result != FRAME_ERROR) || (dec.Overflows != 1))
+        Fail("a frame over FRAME_MAX_PAYLOAD was not counted", FRAME_MAX_PAYLOAD + 1);
+    for(; i < n; i++)
+        Frame_Decode(&dec, frame[i]);
+    if(Feed(&dec, next, nextLen) != FRAME_READY)
+        Fail("no frame after an overflow", 24);
+
+    printf("frame: %u frames encoded, %u bits flipped, %lu frames dropped for it, %lu wrong\n",
+        frames, bits, dropped, wrong);
+
+    /* ADC 0x03FF       3300 mV\r\n against the two values in a frame */
+    data[0] = 0x03;
+    data[1] = 0xFF;
+    data[2] = 3300 >> 8;
+    data[3] = 3300 & 0xFF;
+    printf("record.c record: 26 bytes as text, %lu as a frame\n", (unsigned long)Frame_Encode(frame, data, 4));
+
+    printf("%s\n", bad ? "FAIL" : "frame ok");
+    return bad != 0;
+}
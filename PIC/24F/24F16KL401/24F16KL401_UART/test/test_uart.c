@@ -0,0 +1,200 @@
+/*
+ * Checks of the interrupt driver on the model
+ *
+ *   test_uart [-c cycles]
+ *
+ * uart.c is built for the host with both UARTs interrupt driven
+ * and run on the model, see model.h. On UART2:
+ *
+ *  - a 40 byte banner is queued with U2_PutBuffer. The call must
+ *    return in under a twentieth of the time the banner takes on
+ *    the wire, and the call and the TX interrupts together must
+ *    take under a tenth of it, the rest of the time the core is
+ *    free. The bytes must go out in order
+ *  - the host sends U2_RXBUF_SIZE bytes back to back while the
+ *    main line does nothing. The RX interrupt must put them all in
+ *    the ring buffer, U2_TryGetChar then gives them back in order
+ *  - the TX interrupt is held off with DISI while the FIFO
+ *    drains, so its last run comes after the last character has
+ *    moved out and it stops with TXIF clear. A byte then queued by
+ *    each of U2_PutChar, U2_TryPutChar, U2_Write, U2_PutBuffer and
+ *    U2_QueueConst must go out within two character times.
+ *    Queuing used to set only TXIE, so the byte waited forever
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xc.h"
+#include "model.h"
+
+/* uart.c as built for the host, int is short, see host.h */
+void U2_Init(void);
+void U2_PutChar(char Ch);
+char U2_TryPutChar(char Ch);
+char U2_TryGetChar(char *pCh);
+size_t U2_Write(const char *pBuf, size_t Len);
+void U2_PutBuffer(const char *pBuf, size_t Len);
+char U2_QueueConst(const char *pData, size_t Len);
+
+#define BANNER_LEN  40
+#define RX_LEN      16                  /* U2_RXBUF_SIZE */
+
+static const char banner[] = "PIC24F16KL401 UART2 interrupt driven  \r\n";
+static const char resume[] = "CTWBQ";   /* one byte for each way of queuing */
+
+static unsigned long bad;
+
+static void Fail(const char *Text)
+{
+    bad++;
+    printf("  %s\n", Text);
+}
+
+/* Step until UART2 has sent Count bytes in all, 0 when it took longer than Cycles */
+static int WaitOut(unsigned long Count, unsigned long long Cycles)
+{
+    unsigned long long end = model.cycle + Cycles;
+
+    while(model.uart[1].outSize < Count)
+    {
+        if(model.cycle >= end)
+            return 0;
+        Model_Step(1);
+    }
+    return 1;
+}
+
+static void Banner(void)
+{
+    ModelTime_t start, queued;
+    unsigned long from = model.uart[1].outSize;
+    unsigned long long begin, wire, cpu;
+
+    begin = model.cycle;
+    start = model.time;
+    U2_PutBuffer(banner, BANNER_LEN);
+    queued = model.time;
+    if(!WaitOut(from + BANNER_LEN, 100 * Model_BitCycles(1) * BANNER_LEN))
+    {
+        Fail("the banner did not go out");
+        return;
+    }
+    /* to the last stop bit */
+    wire = model.uart[1].outAt[model.uart[1].outSize - 1] - begin;
+    cpu = (queued.mainCycles - start.mainCycles) + (model.time.isrCycles - start.isrCycles);
+    printf("%d byte banner: U2_PutBuffer %llu cycles, with the TX interrupts %llu, on the wire %llu, core free %.1f%%\n",
+        BANNER_LEN, queued.mainCycles - start.mainCycles, cpu, wire, 100.0 * (double)(wire - cpu) / (double)wire);
+    if((queued.mainCycles - start.mainCycles) * 20 > wire)
+        Fail("U2_PutBuffer waited for the UART");
+    if(cpu * 10 > wire)
+        Fail("the banner took more than a tenth of the core");
+    if(memcmp(&model.uart[1].out[from], banner, BANNER_LEN))
+        Fail("the banner came out wrong");
+}
+
+static void Receive(void)
+{
+    ModelBurst_t *b = &model.script[model.scriptSize];
+    unsigned long long isr = model.time.isrCycles;
+    unsigned long from = model.uart[1].sentSize;
+    char ch;
+    int n;
+
+    memset(b, 0, sizeof(*b));
+    b->uart = 1;
+    b->at = model.cycle + MODEL_US(1000);
+    b->count = RX_LEN;
+    model.scriptSize++;
+    while((model.uart[1].sentSize < from + RX_LEN) || model.uart[1].rxBusy || model.uart[1].fifoSize)
+        Model_Step(1);
+    for(n = 0; U2_TryGetChar(&ch); n++)
+    {
+        if((n >= RX_LEN) || ((unsigned char)ch != model.uart[1].sent[from + n]))
+        {
+            Fail("the ring buffer did not give back the bytes sent");
+            return;
+        }
+    }
+    printf("%d bytes in back to back: RX interrupts %llu cycles a byte, %d in the ring buffer\n",
+        RX_LEN, (model.time.isrCycles - isr) / RX_LEN, n);
+    if((n != RX_LEN) || model.uart[1].overruns)
+        Fail("bytes were lost");
+}
+
+static void Resume(void)
+{
+    unsigned long long limit = 20 * Model_BitCycles(1);
+    unsigned long from;
+    int n;
+
+    for(n = 0; resume[n]; n++)
+    {
+        /*
+         * Five bytes, the ISR puts the last four in the FIFO and
+         * leaves with the ring empty and TXIE on. DISI then holds
+         * it off while the FIFO drains, so it runs after the last
+         * character has moved out, clears TXIF and turns TXIE off
+         * with nothing left to raise TXIF again.
+         */
+        U2_PutBuffer("-----", 5);
+        Model_Step(200);
+        __builtin_disi(0x3FFF);
+        while(model.disi)
+            Model_Step(1);
+        Model_Step(200);
+        if(_U2TXIE || _U2TXIF || model.uart[1].txSize || model.uart[1].tsrBusy)
+        {
+            Fail("the TX interrupt did not stop with TXIF clear");
+            return;
+        }
+        from = model.uart[1].outSize;
+        switch(n)
+        {
+        case 0: U2_PutChar(resume[n]); break;
+        case 1: U2_TryPutChar(resume[n]); break;
+        case 2: U2_Write(&resume[n], 1); break;
+        case 3: U2_PutBuffer(&resume[n], 1); break;
+        default: U2_QueueConst(&resume[n], 1); break;
+        }
+        if(!WaitOut(from + 1, limit) || (model.uart[1].out[from] != (unsigned char)resume[n]))
+        {
+            printf("  byte %d of \"%s\": ", n, resume);
+            Fail("not sent after the TX interrupt stopped");
+        }
+    }
+    printf("TX restart after the TX interrupt stopped with TXIF clear: %d ways of queuing checked\n", n);
+}
+
+static void Main(void)
+{
+    U2_Init();
+    Model_Step(MODEL_US(1000));
+    Banner();
+    Receive();
+    Resume();
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    Model_Reset();
+    while((opt = getopt(argc, argv, "c:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'c': model.bbCycles = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-c cycles]\n", argv[0]);
+            return 2;
+        }
+    }
+    Model_AddWait((const void *)U2_PutChar);
+    Model_AddWait((const void *)U2_PutBuffer);
+
+    if(!Model_Run(Main, MODEL_US(10000000UL)))
+        Fail("the checks did not finish");
+    printf("%s\n", bad ? "FAIL" : "uart ok");
+    return bad != 0;
+}
@@ -0,0 +1,255 @@
+/*
+ * UART throughput bench on the model
+ *
+ *   uart_bench [-q] [-c cycles] [-t ms] [-w us] [-e lost] [-n] [-z] script
+ *
+ * Runs main.c, built for the host with the model, for -t
+ * milliseconds, 10000 by default, while the host sends the bytes
+ * of the script, see Model_LoadScript. main.c echoes UART2, or
+ * with APP_BRIDGE passes UART1 to UART2 and back, and the bench
+ * checks that what comes out is what went in, in order, with
+ * nothing but lost bytes missing. For each UART it lists:
+ *
+ *   bytes/s    bytes passed on over the time from the first byte
+ *              sent to the last byte out
+ *   lost       bytes the UART lost to OERR, while the clock was
+ *              off in Sleep, or while it was off, and bytes that
+ *              came in but never went out, which the driver drops
+ *              when its ring buffer is full
+ *   overruns   times the model set OERR and the driver counters
+ *
+ * and then where the core spent the time from the first byte
+ * sent: the main line running, of that the busy-wait in the
+ * driver calls that wait for the UART, the interrupts, Idle and
+ * Sleep. -c sets the cycles for each basic block, see model.h,
+ * -w the Sleep wake-up time in microseconds.
+ *
+ * In the echo build the bytes UART2 sends up to the end of the
+ * startup status record are not part of the echo, the script
+ * should start after it, about 3.5 seconds after reset.
+ *
+ * The exit code is 1 when the output is not the input in order,
+ * when -e is given and the bytes lost are not that many, with -n
+ * when a UART set OERR, or with -z when a lost byte is not 0x00.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "xc.h"
+#include "model.h"
+
+/* main.c and uart.c as built for the host, int is short, see host.h */
+short app_main(void);
+typedef struct {
+    unsigned short Overrun;
+    unsigned short Framing;
+    unsigned short Parity;
+    unsigned short Dropped;
+    unsigned short RxHighWater;
+} BenchStats_t;
+void U1_GetStats(BenchStats_t *pStats, char Reset) __attribute__((weak));
+void U2_GetStats(BenchStats_t *pStats, char Reset) __attribute__((weak));
+void U1_PutChar(char Ch) __attribute__((weak));
+void U2_PutChar(char Ch) __attribute__((weak));
+char U1_GetChar(void) __attribute__((weak));
+char U2_GetChar(void) __attribute__((weak));
+void U1_PutBuffer(const char *pBuf, size_t Len) __attribute__((weak));
+void U2_PutBuffer(const char *pBuf, size_t Len) __attribute__((weak));
+void U1_PutConst(const char *pData, size_t Len) __attribute__((weak));
+void U2_PutConst(const char *pData, size_t Len) __attribute__((weak));
+
+static void Main(void)
+{
+    app_main();
+}
+
+/*
+ * Match what a UART sent against what the host sent the other
+ * one, Out may only leave bytes out. Returns the bytes matched or
+ * -1 when Out has a byte that is not next in In.
+ */
+static long Match(const ModelUart_t *In, const ModelUart_t *Out, unsigned long From,
+    unsigned long long *pLast)
+{
+    unsigned long i, o;
+
+    i = 0;
+    for(o = From; o < Out->outSize; o++)
+    {
+        while((i < In->sentSize) && (In->sent[i] != Out->out[o]))
+            i++;
+        if(i >= In->sentSize)
+            return -1;
+        i++;
+        *pLast = Out->outAt[o];
+    }
+    return (long)(Out->outSize - From);
+}
+
+static double Percent(unsigned long long Part, unsigned long long Whole)
+{
+    return Whole ? 100.0 * Part / Whole : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+    int quiet = 0;
+    unsigned long ms = 10000;
+    long expectLost = -1;
+    int zeroLost = 0;
+    int noOverrun = 0;
+    int opt;
+    int u, to;
+    int bad = 0;
+    unsigned long from[MODEL_UARTS];
+    unsigned long i, lost, lostAll = 0;
+    unsigned long long first, last, span;
+    long passed;
+    BenchStats_t stats;
+    ModelTime_t t;
+    unsigned long long total;
+
+    Model_Reset();
+    while((opt = getopt(argc, argv, "qc:t:w:e:nz")) != -1)
+    {
+        switch(opt)
+        {
+        case 'q': quiet = 1; break;
+        case 'c': model.bbCycles = (unsigned)atoi(optarg); break;
+        case 't': ms = strtoul(optarg, NULL, 0); break;
+        case 'w': model.wakeCycles = (unsigned long)MODEL_US(strtoul(optarg, NULL, 0)); break;
+        case 'e': expectLost = atol(optarg); break;
+        case 'n': noOverrun = 1; break;
+        case 'z': zeroLost = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-q] [-c cycles] [-t ms] [-w us] [-e lost] [-n] [-z] script\n", argv[0]);
+            return 2;
+        }
+    }
+    if((optind >= argc) || Model_LoadScript(argv[optind]))
+    {
+        fprintf(stderr, "usage: %s [-q] [-c cycles] [-t ms] [-w us] [-e lost] [-n] [-z] script\n", argv[0]);
+        return 2;
+    }
+    model.markAt = ~0ULL;
+    for(i = 0; i < (unsigned long)model.scriptSize; i++)
+        if(model.script[i].at < model.markAt)
+            model.markAt = model.script[i].at;
+    Model_AddWait((const void *)U1_PutChar);
+    Model_AddWait((const void *)U2_PutChar);
+    Model_AddWait((const void *)U1_GetChar);
+    Model_AddWait((const void *)U2_GetChar);
+    Model_AddWait((const void *)U1_PutBuffer);
+    Model_AddWait((const void *)U2_PutBuffer);
+    Model_AddWait((const void *)U1_PutConst);
+    Model_AddWait((const void *)U2_PutConst);
+
+    Model_Run(Main, MODEL_US(ms * 1000UL));
+
+    printf("%s, %lums, %u cycles a basic block\n", argv[optind], ms, model.bbCycles);
+
+    /* where each UART output starts */
+    from[0] = 0;
+    from[1] = 0;
+#if !BENCH_BRIDGE
+    for(i = 2; i < model.uart[1].outSize; i++)
+    {
+        if((model.uart[1].out[i - 2] == '%') && (model.uart[1].out[i - 1] == '\r') && (model.uart[1].out[i] == '\n'))
+        {
+            from[1] = i + 1;
+            break;
+        }
+    }
+    if(!quiet)
+    {
+        printf("UART2 startup: ");
+        fwrite(model.uart[1].out, 1, from[1], stdout);
+    }
+#endif
+
+    for(u = 0; u < MODEL_UARTS; u++)
+    {
+        ModelUart_t *in = &model.uart[u];
+
+        if(in->sentSize == 0)
+            continue;
+#if BENCH_BRIDGE
+        to = !u;
+#else
+        to = u;
+#endif
+        first = in->sentAt[0];
+        last = first;
+        passed = Match(in, &model.uart[to], from[to], &last);
+        if(passed < 0)
+        {
+            printf("FAIL: UART%d sent a byte that UART%d was not sent\n", to + 1, u + 1);
+            bad = 1;
+            continue;
+        }
+        lost = in->sentSize - (unsigned long)passed;
+        lostAll += lost;
+        span = last - first;
+        printf("UART%d to UART%d, host at %lu baud: sent %lu, passed on %ld, %.0f bytes/s, lost %lu\n",
+            u + 1, to + 1, MODEL_FCYC / ((in->hostBaud ? (MODEL_FCYC + in->hostBaud / 2) / in->hostBaud : Model_BitCycles(u))),
+            in->sentSize, passed, span ? (double)passed * MODEL_FCYC / span : 0.0, lost);
+        printf("  UART%d: received %lu, OERR set %lu times losing %lu, lost in Sleep %lu, while off %lu, framing %lu, RTS held %lu cycles\n",
+            u + 1, in->received, in->overruns, in->overrunLost, in->sleepLost, in->offLost, in->framing, in->rtsHeld);
+        if((u == 0) && U1_GetStats)
+            U1_GetStats(&stats, 0);
+        else if((u == 1) && U2_GetStats)
+            U2_GetStats(&stats, 0);
+        else
+            memset(&stats, 0, sizeof(stats));
+        printf("  driver: Overrun %u, Framing %u, Parity %u, Dropped %u, RxHighWater %u\n",
+            stats.Overrun, stats.Framing, stats.Parity, stats.Dropped, stats.RxHighWater);
+        if(noOverrun && in->overruns)
+        {
+            printf("FAIL: UART%d set OERR\n", u + 1);
+            bad = 1;
+        }
+        for(i = 0; zeroLost && (i < in->lostSize); i++)
+        {
+            if(in->lost[i] != 0x00)
+            {
+                printf("FAIL: UART%d lost 0x%02X, only 0x00 wake bytes may be lost\n", u + 1, in->lost[i]);
+                bad = 1;
+                break;
+            }
+        }
+        if(zeroLost && (in->lostSize != lost))
+        {
+            printf("FAIL: UART%d lost %lu bytes, the UART lost %lu\n", u + 1, lost, in->lostSize);
+            bad = 1;
+        }
+    }
+
+    t = model.time;
+    if(model.markAt != ~0ULL && model.cycle > model.markAt)
+    {
+        t.mainCycles -= model.mark.mainCycles;
+        t.busyCycles -= model.mark.busyCycles;
+        t.isrCycles -= model.mark.isrCycles;
+        t.idleCycles -= model.mark.idleCycles;
+        t.sleepCycles -= model.mark.sleepCycles;
+        t.isrRuns -= model.mark.isrRuns;
+    }
+    total = t.mainCycles + t.isrCycles + t.idleCycles + t.sleepCycles;
+    printf("core from the first byte: main %.1f%% (busy-wait %.1f%%, %llu cycles), ISR %.1f%%, Idle %.1f%%, Sleep %.1f%%\n",
+        Percent(t.mainCycles, total), Percent(t.busyCycles, total), t.busyCycles,
+        Percent(t.isrCycles, total), Percent(t.idleCycles, total), Percent(t.sleepCycles, total));
+    printf("  %lu ISR runs, longest %lu cycles", t.isrRuns, model.isrMax);
+    if(model.wakes)
+        printf(", %lu wakes from Sleep, start bit to the next byte read mean %llu max %lu cycles",
+            model.wakes, model.wakeToByteCount ? model.wakeToByte / model.wakeToByteCount : 0, model.wakeToByteMax);
+    printf("\n");
+
+    if((expectLost >= 0) && ((unsigned long)expectLost != lostAll))
+    {
+        printf("FAIL: %lu bytes lost, %ld expected\n", lostAll, expectLost);
+        bad = 1;
+    }
+    printf("%s\n", bad ? "FAIL" : "output matches the input");
+    return bad;
+}
@@ -0,0 +1,177 @@
+/*
+ * Host stand-in for the XC16 device header of the PIC24F16KL401
+ *
+ * Only the registers and bits the UART project uses are here.
+ * Each register is a plain variable, the bits alias it through a
+ * union laid out as on the part, low bit first, so a write to
+ * U2STA shows in U2STAbits. The single bit names, _U2RXIF and
+ * the like, are the same fields as in the XC16 header.
+ *
+ * Registers the model must see being used are not plain:
+ *
+ *   UxTXREG    wider than the real register, it holds XC_TXREG_EMPTY
+ *              until a byte is written, so the model sees the write
+ *   UxRXREG    a call into the model, which pops the receive FIFO
+ *   Idle, Sleep, ClrWdt, __builtin_disi
+ *              calls into the model, see model.h
+ *
+ * The registers are defined in the file that includes this one
+ * with XC_SFR_DEFINE set, see sfr.c.
+ */
+#ifndef XC_H
+#define XC_H
+
+#ifdef XC_SFR_DEFINE
+#define XC_SFR volatile
+#else
+#define XC_SFR extern volatile
+#endif
+
+/* XC16 attributes with no meaning on the host */
+#define interrupt
+#define no_auto_psv
+
+/* register with named bits, low bit first */
+#define XC_SFR16(name, ...) \
+    typedef union { unsigned short reg; struct { unsigned __VA_ARGS__; } bits; } name##_t; \
+    XC_SFR name##_t name##_sfr
+
+/* register type with named bits and a second set of names for the same bits */
+#define XC_TYPE16X(type, first, second) \
+    typedef union { unsigned short reg; struct { union { struct { unsigned first; }; struct { unsigned second; }; }; } bits; } type
+
+/* CPU */
+XC_SFR16(INTCON1, :15, NSTDIS:1);
+#define INTCON1     INTCON1_sfr.reg
+#define _NSTDIS     INTCON1_sfr.bits.NSTDIS
+XC_SFR unsigned short RCON;
+XC_SFR unsigned short CLKDIV;
+
+XC_SFR16(OSCCON, OSWEN:1, LPOSCEN:1, :14);
+#define OSCCON      OSCCON_sfr.reg
+#define OSCCONbits  OSCCON_sfr.bits
+#define _OSCCON_OSWEN_POSITION      0
+#define _OSCCON_LPOSCEN_POSITION    1
+
+/* The clock switch is done at once, OSWEN is never left set */
+#define __builtin_write_OSCCONL(value)  (OSCCON = (OSCCON & 0xFF00) | ((value) & 0xFE))
+#define __builtin_write_OSCCONH(value)  (OSCCON = (OSCCON & 0x00FF) | (((value) & 0xFF) << 8))
+
+/* Interrupt flags, enables and priorities */
+XC_SFR16(IFS0, :3, T1IF:1, :7, U1RXIF:1, U1TXIF:1, :3);
+XC_SFR16(IFS1, :14, U2RXIF:1, U2TXIF:1);
+XC_SFR16(IFS4, :1, U1ERIF:1, U2ERIF:1, :13);
+XC_SFR16(IEC0, :3, T1IE:1, :7, U1RXIE:1, U1TXIE:1, :3);
+XC_SFR16(IEC1, :14, U2RXIE:1, U2TXIE:1);
+XC_SFR unsigned short IEC2, IEC3, IEC5;
+XC_SFR16(IEC4, :1, U1ERIE:1, U2ERIE:1, :13);
+XC_SFR16(IPC0, :12, T1IP:3, :1);
+XC_SFR16(IPC2, :12, U1RXIP:3, :1);
+XC_SFR16(IPC3, U1TXIP:3, :13);
+XC_SFR16(IPC7, :8, U2RXIP:3, :1, U2TXIP:3, :1);
+XC_SFR16(IPC16, :4, U1ERIP:3, :1, U2ERIP:3, :5);
+#define IFS0        IFS0_sfr.reg
+#define IFS1        IFS1_sfr.reg
+#define IFS4        IFS4_sfr.reg
+#define IEC0        IEC0_sfr.reg
+#define IEC1        IEC1_sfr.reg
+#define IEC4        IEC4_sfr.reg
+#define _T1IF       IFS0_sfr.bits.T1IF
+#define _U1RXIF     IFS0_sfr.bits.U1RXIF
+#define _U1TXIF     IFS0_sfr.bits.U1TXIF
+#define _U2RXIF     IFS1_sfr.bits.U2RXIF
+#define _U2TXIF     IFS1_sfr.bits.U2TXIF
+#define _U1ERIF     IFS4_sfr.bits.U1ERIF
+#define _U2ERIF     IFS4_sfr.bits.U2ERIF
+#define _T1IE       IEC0_sfr.bits.T1IE
+#define _U1RXIE     IEC0_sfr.bits.U1RXIE
+#define _U1TXIE     IEC0_sfr.bits.U1TXIE
+#define _U2RXIE     IEC1_sfr.bits.U2RXIE
+#define _U2TXIE     IEC1_sfr.bits.U2TXIE
+#define _U1ERIE     IEC4_sfr.bits.U1ERIE
+#define _U2ERIE     IEC4_sfr.bits.U2ERIE
+#define _T1IP       IPC0_sfr.bits.T1IP
+#define _U1RXIP     IPC2_sfr.bits.U1RXIP
+#define _U1TXIP     IPC3_sfr.bits.U1TXIP
+#define _U2RXIP     IPC7_sfr.bits.U2RXIP
+#define _U2TXIP     IPC7_sfr.bits.U2TXIP
+#define _U1ERIP     IPC16_sfr.bits.U1ERIP
+#define _U2ERIP     IPC16_sfr.bits.U2ERIP
+
+/* Ports */
+XC_SFR unsigned short ANSA, ANSB, LATA, TRISA;
+XC_SFR16(LATB, LATB0:1, LATB1:1, LATB2:1, :4, LATB7:1, :7, LATB15:1);
+XC_SFR16(TRISB, TRISB0:1, TRISB1:1, TRISB2:1, :4, TRISB7:1, :8);
+XC_SFR16(PORTB, RB0:1, RB1:1, RB2:1, :4, RB7:1, :8);
+#define LATB        LATB_sfr.reg
+#define TRISB       TRISB_sfr.reg
+#define PORTB       PORTB_sfr.reg
+#define _LATB0      LATB_sfr.bits.LATB0
+#define _LATB7      LATB_sfr.bits.LATB7
+#define _LATB15     LATB_sfr.bits.LATB15
+#define _TRISB0     TRISB_sfr.bits.TRISB0
+#define _TRISB1     TRISB_sfr.bits.TRISB1
+#define _TRISB2     TRISB_sfr.bits.TRISB2
+#define _TRISB7     TRISB_sfr.bits.TRISB7
+#define _RB1        PORTB_sfr.bits.RB1
+#define _RB2        PORTB_sfr.bits.RB2
+
+/* Peripheral module disable */
+XC_SFR unsigned short PMD1, PMD2, PMD3, PMD4;
+
+/* Timer1 */
+XC_SFR16(T1CON, :1, TCS:1, TSYNC:1, :1, TCKPS:2, TGATE:1, :6, TSIDL:1, :1, TON:1);
+XC_SFR unsigned short TMR1, PR1;
+#define T1CON       T1CON_sfr.reg
+#define T1CONbits   T1CON_sfr.bits
+#define _TON        T1CON_sfr.bits.TON
+
+/* UART1 and UART2 */
+#define XC_UMODE_BITS   STSEL:1, PDSEL:2, BRGH:1, RXINV:1, ABAUD:1, LPBACK:1, WAKE:1, UEN:2, :1, RTSMD:1, IREN:1, USIDL:1, :1, UARTEN:1
+#define XC_UMODE_ALT    :1, PDSEL0:1, PDSEL1:1, :5, UEN0:1, UEN1:1, :6
+#define XC_USTA_BITS    URXDA:1, OERR:1, FERR:1, PERR:1, RIDLE:1, ADDEN:1, URXISEL:2, TRMT:1, UTXBF:1, UTXEN:1, UTXBRK:1, :1, UTXISEL0:1, UTXINV:1, UTXISEL1:1
+#define XC_USTA_ALT     :6, URXISEL0:1, URXISEL1:1, :8
+
+/* one type for both UARTs so the model can take either */
+XC_TYPE16X(XC_UMODE_t, XC_UMODE_BITS, XC_UMODE_ALT);
+XC_TYPE16X(XC_USTA_t, XC_USTA_BITS, XC_USTA_ALT);
+XC_SFR XC_UMODE_t U1MODE_sfr, U2MODE_sfr;
+XC_SFR XC_USTA_t U1STA_sfr, U2STA_sfr;
+XC_SFR unsigned short U1BRG, U2BRG;
+XC_SFR unsigned long U1TXREG, U2TXREG;
+#define U1MODE      U1MODE_sfr.reg
+#define U1MODEbits  U1MODE_sfr.bits
+#define U1STA       U1STA_sfr.reg
+#define U1STAbits   U1STA_sfr.bits
+#define U2MODE      U2MODE_sfr.reg
+#define U2MODEbits  U2MODE_sfr.bits
+#define U2STA       U2STA_sfr.reg
+#define U2STAbits   U2STA_sfr.bits
+
+/* The short names the XC16 header gives the UART1 bits */
+#define _BRGH       U1MODEbits.BRGH
+#define _UARTEN     U1MODEbits.UARTEN
+#define _URXDA      U1STAbits.URXDA
+#define _OERR       U1STAbits.OERR
+#define _TRMT       U1STAbits.TRMT
+#define _UTXBF      U1STAbits.UTXBF
+#define _UTXEN      U1STAbits.UTXEN
+
+/* A char written to UxTXREG cannot look like this, see above */
+#define XC_TXREG_EMPTY  0x10000UL
+
+unsigned short XC_ReadRxReg(unsigned char Uart);
+#define U1RXREG     XC_ReadRxReg(1)
+#define U2RXREG     XC_ReadRxReg(2)
+
+/* Core */
+void XC_Disi(unsigned short Cycles);
+void XC_Idle(void);
+void XC_Sleep(void);
+#define __builtin_disi(cycles)  XC_Disi(cycles)
+#define Idle()      XC_Idle()
+#define Sleep()     XC_Sleep()
+#define ClrWdt()    ((void)0)
+#define Nop()       ((void)0)
+
+#endif
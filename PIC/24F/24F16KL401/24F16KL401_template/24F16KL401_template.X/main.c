@@ -92,26 +92,17 @@
 // FICD
 #pragma config ICS = PGx2               // ICD Pin Placement Select (EMUC/EMUD share PGC2/PGD2)
 /*
- * Define constants for how we will configure the clock
+ * Define constants for how we will configure the clock,
+ * the project gives FCYC to tick.c in its preprocessor macros
  */
 #define FOSC (4000000UL)
-#define FCYC (FOSC/2)
-/* warning non-portable function */
+#if FCYC != (FOSC/2)
+#error FCYC in the project preprocessor macros does not match FOSC
+#endif
 /*
- * This function waits for the at least the
- * specified number milliseconds then returns.
+ * Timer1 tick shared with the UART example
  */
-void delay( unsigned long wait_ms )
-{
-    for (;wait_ms; --wait_ms)
-    {
-        asm("    repeat  %0 \n"
-            "    clrwdt     \n"
-            : /* no outputs */
-            : "r" ((unsigned short)(FCYC/1000-1))
-            );
-    }
-}
+#include "../../24F16KL401_UART/24F16KL401_UART.X/tick.h"
 /*
  * main application
  */
@@ -159,9 +150,10 @@ int main( void )
     
     CLKDIV = 0x0100;    /* select DOZE 1:1, DOZE disabled, RCDIV 0b001 (4MHz) */
     
-    delay(500);
+    Tick_Init();
+    Tick_Wait(500);
     _LATB15 = 1;
-    delay(250);
+    Tick_Wait(250);
     _LATB15 = 0;
     for(;;)
     {
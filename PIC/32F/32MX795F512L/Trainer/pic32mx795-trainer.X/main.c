@@ -10,6 +10,14 @@
 **  Send a string of text out UART3 at 57600 baud
 **  Echo characters received from UART1 to UART1
 **
+** Notes:
+**  Text goes out of the UART by DMA. SendDataBuffer queues a
+**  buffer and returns, DMA channel 0 moves one character into
+**  the UART for each TX interrupt request, so the CPU only works
+**  at the start and end of each block. The buffer must not be
+**  changed until its done function is called. The echo goes
+**  through the same queue.
+**
 */
 
 // Adds support for PIC32 Peripheral library functions and macros
@@ -52,6 +60,40 @@
 #define UART UART1
 #define BAUD_RATE (56000ul)
 
+/* DMA transmit for the UART above */
+#define TX_DMA_CHANNEL  DMA_CHANNEL0
+#define TX_DMA_IRQ      _UART1_TX_IRQ
+#define TX_DMA_TXREG    U1TXREG
+#define TX_DMA_UTXBF    U1STAbits.UTXBF
+#define TX_QUEUE_SIZE   4           /* buffers waiting or being sent */
+#define TX_BLOCK_MAX    255ul       /* characters in one DMA block */
+#define TX_TEST         0           /* send TX_TEST_SIZE in a loop and measure it */
+#define TX_TEST_SIZE    1024
+#define ECHO_BUF_SIZE   32          /* characters echoed in one buffer */
+
+typedef void (*TxDoneFunc_t)( const char *buffer );
+
+typedef struct {
+    const char *buffer;             /* next character to send */
+    UINT32 size;                    /* characters left */
+    const char *start;              /* buffer as queued, for pDone */
+    TxDoneFunc_t pDone;             /* called from the DMA interrupt, may be NULL */
+} TX_QUEUE_ENTRY;
+
+static TX_QUEUE_ENTRY TxQueue[TX_QUEUE_SIZE];
+static volatile UINT32 TxHead;      /* next free entry, main only */
+static volatile UINT32 TxTail;      /* entry being sent, DMA interrupt only */
+static volatile UINT32 TxCount;     /* entries queued */
+static volatile UINT32 TxBlock;     /* characters in the DMA block running */
+static volatile UINT32 TxBytes;     /* characters sent */
+static volatile UINT32 TxCycles;    /* CPU cycles spent to send them */
+
+static char EchoBuf[2][ECHO_BUF_SIZE];
+static UINT32 EchoSide;             /* EchoBuf filled by main */
+static UINT32 EchoFill;             /* characters in it */
+static volatile BOOL EchoBusy;      /* the other EchoBuf is queued */
+static volatile UINT32 EchoDropped; /* characters not echoed, both buffers full */
+
 void DelayMS( unsigned long Delay )
 {
     unsigned long Time0, Time1;
@@ -73,23 +115,154 @@ void DelayMS( unsigned long Delay )
 }
 
 // *****************************************************************************
-// void UARTTxBuffer(char *buffer, UINT32 size)
+// void TxDmaInit(void)
+//
+// Set up the DMA channel to write TX_DMA_TXREG each time the UART
+// asks for a character. The UART must be set to interrupt on TX
+// not full. Only the DMA channel interrupt goes to the CPU.
 // *****************************************************************************
-void SendDataBuffer( UART_MODULE id, const char *buffer, UINT32 size )
+void TxDmaInit( void )
 {
-    while(size)
-    {
-        while(!UARTTransmitterIsReady(id))
-            ;
+    TxHead = 0;
+    TxTail = 0;
+    TxCount = 0;
+    TxBlock = 0;
+    TxBytes = 0;
+    TxCycles = 0;
 
-        UARTSendDataByte(id, *buffer);
+    DmaChnOpen(TX_DMA_CHANNEL, DMA_CHN_PRI2, DMA_OPEN_DEFAULT);
+    DmaChnSetEventControl(TX_DMA_CHANNEL, DMA_EV_START_IRQ_EN | DMA_EV_START_IRQ(TX_DMA_IRQ));
+    DmaChnSetEvEnableFlags(TX_DMA_CHANNEL, DMA_EV_BLOCK_DONE);
+    DmaChnSetIntPriority(TX_DMA_CHANNEL, INT_PRIORITY_LEVEL_5, INT_SUB_PRIORITY_LEVEL_3);
+    DmaChnIntEnable(TX_DMA_CHANNEL);
+}
 
-        buffer++;
-        size--;
+// *****************************************************************************
+// void TxDmaStart(void)
+//
+// Start a DMA block for the next part of the buffer at the tail of
+// the queue. Called with the DMA interrupt off or from it.
+//
+// The UART asks for a character each time one leaves the FIFO, an
+// idle UART asks for none, so the first one is forced when the
+// FIFO has room. It is not forced when the FIFO is full, that
+// character would be lost. A request that comes between the test
+// and the force is for a character that left, so the room is
+// still there.
+// *****************************************************************************
+static void TxDmaStart( void )
+{
+    TX_QUEUE_ENTRY *pEntry;
+
+    pEntry = &TxQueue[TxTail];
+    TxBlock = pEntry->size;
+    if (TxBlock > TX_BLOCK_MAX)
+        TxBlock = TX_BLOCK_MAX;
+
+    DmaChnSetTxfer(TX_DMA_CHANNEL, (void *)pEntry->buffer, (void *)&TX_DMA_TXREG, TxBlock, 1, 1);
+    DmaChnEnable(TX_DMA_CHANNEL);
+    if (!TX_DMA_UTXBF)
+        DmaChnForceTxfer(TX_DMA_CHANNEL);
+}
+
+// *****************************************************************************
+// BOOL SendDataBuffer(const char *buffer, UINT32 size, TxDoneFunc_t pDone)
+//
+// Queue a buffer to send by DMA and return at once. pDone is
+// called from the DMA interrupt when the last character is in the
+// UART, not yet on the wire. A buffer of size 0 is not queued,
+// pDone is called at once from SendDataBuffer.
+//
+// Returns FALSE when the queue is full, the buffer is not sent.
+// *****************************************************************************
+BOOL SendDataBuffer( const char *buffer, UINT32 size, TxDoneFunc_t pDone )
+{
+    TX_QUEUE_ENTRY *pEntry;
+    UINT32 Start;
+
+    if (size == 0)
+    {
+        if (pDone)
+            pDone(buffer);
+        return TRUE;
     }
+    if (TxCount >= TX_QUEUE_SIZE)
+        return FALSE;
+
+    Start = _CP0_GET_COUNT();
+    pEntry = &TxQueue[TxHead];
+    pEntry->buffer = buffer;
+    pEntry->size = size;
+    pEntry->start = buffer;
+    pEntry->pDone = pDone;
+    TxHead = (TxHead + 1) % TX_QUEUE_SIZE;
+
+    DmaChnIntDisable(TX_DMA_CHANNEL);
+    if (TxCount++ == 0)
+        TxDmaStart();
+    TxCycles += (_CP0_GET_COUNT() - Start) * 2;
+    DmaChnIntEnable(TX_DMA_CHANNEL);
+    return TRUE;
+}
+
+// *****************************************************************************
+// BOOL TxDmaIdle(void)
+//
+// Returns TRUE when every queued buffer has gone to the UART.
+// *****************************************************************************
+BOOL TxDmaIdle( void )
+{
+    return (TxCount == 0);
+}
+
+// *****************************************************************************
+// void TxDmaGetStats(UINT32 *pBytes, UINT32 *pCycles)
+//
+// Characters sent by DMA and the CPU cycles spent on them in
+// SendDataBuffer and the DMA interrupt, measured with the core
+// timer which counts every other cycle. The interrupt entry and
+// exit code is not in the count.
+// *****************************************************************************
+void TxDmaGetStats( UINT32 *pBytes, UINT32 *pCycles )
+{
+    DmaChnIntDisable(TX_DMA_CHANNEL);
+    *pBytes = TxBytes;
+    *pCycles = TxCycles;
+    DmaChnIntEnable(TX_DMA_CHANNEL);
+}
+
+// *****************************************************************************
+// DMA channel 0 interrupt
+//
+// A block is done, start the rest of the buffer or the next one
+// in the queue.
+// *****************************************************************************
+void __ISR(_DMA_0_VECTOR, IPL5SOFT) DmaHandler0( void )
+{
+    TX_QUEUE_ENTRY *pEntry;
+    UINT32 Start;
 
-    while(!UARTTransmissionHasCompleted(id))
-        ;
+    Start = _CP0_GET_COUNT();
+    if (DmaChnGetEvFlags(TX_DMA_CHANNEL) & DMA_EV_BLOCK_DONE)
+    {
+        DmaChnClrEvFlags(TX_DMA_CHANNEL, DMA_EV_BLOCK_DONE);
+
+        pEntry = &TxQueue[TxTail];
+        pEntry->buffer += TxBlock;
+        pEntry->size -= TxBlock;
+        TxBytes += TxBlock;
+        if (pEntry->size == 0)
+        {
+            if (pEntry->pDone)
+                pEntry->pDone(pEntry->start);
+            TxTail = (TxTail + 1) % TX_QUEUE_SIZE;
+            TxCount--;
+        }
+        if (TxCount)
+            TxDmaStart();
+    }
+    DmaChnClrIntFlag(TX_DMA_CHANNEL);
+    TxCycles += (_CP0_GET_COUNT() - Start) * 2;
 }
 static inline void __attribute__((always_inline)) UARTClearOverrun ( UART_MODULE id )
 {
@@ -135,6 +308,42 @@ UINT32 GetDataBuffer( UART_MODULE id, char *buffer, UINT32 max_size )
 }
 
 
+static void EchoSent( const char *buffer )
+{
+    EchoBusy = FALSE;
+}
+
+// *****************************************************************************
+// void EchoFlush(void)
+//
+// Queue the characters collected for the echo when the last echo
+// buffer has been sent.
+// *****************************************************************************
+static void EchoFlush( void )
+{
+    if (EchoFill && !EchoBusy)
+    {
+        EchoBusy = TRUE;
+        if (SendDataBuffer(EchoBuf[EchoSide], EchoFill, EchoSent))
+        {
+            EchoSide ^= 1;
+            EchoFill = 0;
+        }
+        else
+        {
+            EchoBusy = FALSE;   /* queue full, try again next time */
+        }
+    }
+}
+
+// *****************************************************************************
+// UINT32 EchoRxTx(UART_MODULE id)
+//
+// The echo goes out through the DMA queue after the buffers that
+// are already in it. Characters are collected in one EchoBuf
+// while the other is sent. When both are full the character is
+// counted in EchoDropped.
+// *****************************************************************************
 UINT32 EchoRxTx( UART_MODULE id )
 {
     UINT8 character;
@@ -146,20 +355,41 @@ UINT32 EchoRxTx( UART_MODULE id )
     if(UARTReceivedDataIsAvailable(id))
     {
         character = UARTGetDataByte(id);
-        if(UARTTransmitterIsReady(id))
-            UARTSendDataByte(id, character);
+        if (EchoFill < ECHO_BUF_SIZE)
+            EchoBuf[EchoSide][EchoFill++] = character;
+        else
+            EchoDropped++;
+        EchoFlush();
         return 1;
     }
+    EchoFlush();
     return 0;
 }
 
+#if TX_TEST
+static volatile BOOL TxTestDone;
+/* results for the debugger watch window, volatile so they are kept */
+volatile UINT32 TestBytes;          /* characters sent so far */
+volatile UINT32 TestCycles;         /* CPU cycles spent to send them */
+volatile UINT32 CyclesPerKB = 0;    /* CPU cycles for each 1024 characters */
+
+void TxTestSent( const char *buffer )
+{
+    TxTestDone = TRUE;
+}
+#endif
+
 //  port_io application code
 int main(void)
 {
     register unsigned int rTemp;
-    UINT8   buf[1024];
+    static char buf[64];
     UINT32  buf_len;
     unsigned long Time0, Time1;
+#if TX_TEST
+    static char TestBuf[TX_TEST_SIZE];
+    UINT32  Bytes, Cycles;
+#endif
 
     // Configure the device for maximum performance, but do not change the PBDIV clock divisor.
     // Given the options, this function will change the program Flash wait states,
@@ -184,6 +414,9 @@ int main(void)
     UARTSetDataRate(UART, GetPeripheralClock(), BAUD_RATE);
     UARTEnable(UART, UART_ENABLE_FLAGS(UART_PERIPHERAL | UART_RX | UART_TX));
 
+    TxDmaInit();
+    INTEnableSystemMultiVectoredInt();
+
     /* start up delay to let MPLAB control the ICD tool */
     DelayMS(500);
     PORTSetBits(IOPORT_B, BIT_0);
@@ -192,7 +425,19 @@ int main(void)
     DelayMS(500);
 
     buf_len = sprintf(buf,"Debug output to UART%1d at 57600 baud\r\n",UART+1);
-    SendDataBuffer(UART, buf, buf_len);
+    SendDataBuffer(buf, buf_len, NULL);
+#if TX_TEST
+    /* lines of text to send while the LEDs chase */
+    for (buf_len = 0; buf_len < TX_TEST_SIZE; buf_len++)
+    {
+        TestBuf[buf_len] = '0' + (buf_len % 10);
+        if ((buf_len % 64) == 62)
+            TestBuf[buf_len] = '\r';
+        if ((buf_len % 64) == 63)
+            TestBuf[buf_len] = '\n';
+    }
+    TxTestDone = TRUE;
+#endif
 #if 0
     /* turn on +5 VDC to prototype area */
     PORTClearBits(IOPORT_F, BIT_5);
@@ -213,5 +458,18 @@ int main(void)
             if (rTemp > 0x80)
                 rTemp = 1;
         }
+#if TX_TEST
+        if (TxTestDone)
+        {
+            /* CPU cycles used to send each 1024 characters */
+            TxDmaGetStats(&Bytes, &Cycles);
+            TestBytes = Bytes;
+            TestCycles = Cycles;
+            if (Bytes)
+                CyclesPerKB = (UINT32)(((unsigned long long)Cycles << 10) / Bytes);
+            TxTestDone = FALSE;
+            SendDataBuffer(TestBuf, TX_TEST_SIZE, TxTestSent);
+        }
+#endif
     }
 }